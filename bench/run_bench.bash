@@ -0,0 +1,155 @@
+#!/bin/bash
+
+# Times each phase of `kodoc build` on generated stress programs, printing a table and writing the results as JSON so
+# that they can be compared across commits.
+# Usage: run_bench.bash <kodoc> [results.json]
+# BENCH_SCALE multiplies the size of every program, and BENCH_RUNS sets how many builds each result is the best of.
+# BENCH_FLAGS is passed on to every build, e.g. BENCH_FLAGS=--discard-value-names.
+
+COMPILER=$(realpath $1)
+RESULTS=${2:-bench_results.json}
+SCALE=${BENCH_SCALE:-1}
+RUNS=${BENCH_RUNS:-3}
+FLAGS=${BENCH_FLAGS:-}
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+# N functions, all called from main.
+gen_functions() {
+    for ((i = 0; i < $1; i++)); do
+        printf 'fn f%d(let x: i32): i32 {\n    return x + %d;\n}\n\n' $i $i
+    done
+    printf 'fn main(): i32 {\n    var sum: i32 = 0;\n'
+    for ((i = 0; i < $1; i++)); do
+        printf '    sum = f%d(sum);\n' $i
+    done
+    printf '    return sum;\n}\n'
+}
+
+# A single expression N operators long, which parses to a tree N deep.
+gen_expression() {
+    printf 'fn main(): i32 {\n    var x: i32 = 1;\n    return x'
+    for ((i = 0; i < $1; i++)); do
+        case $((i % 3)) in
+        0) printf ' + x * x' ;;
+        1) printf ' - x' ;;
+        2) printf ' + x / x' ;;
+        esac
+    done
+    printf ';\n}\n'
+}
+
+# N ifs in a row, each joining back up with the next.
+gen_if_chain() {
+    printf 'fn main(): i32 {\n    var x: i32 = %d;\n    var y: i32 = 0;\n' $1
+    for ((i = 0; i < $1; i++)); do
+        printf '    if (x > %d) {\n        y = y + x;\n    }\n    x = x - 1;\n' $i
+    done
+    printf '    return y;\n}\n'
+}
+
+# N traits, each implemented by its own struct and called through a trait pointer.
+gen_types() {
+    for ((i = 0; i < $1; i++)); do
+        printf 'type T%d = trait {\n    fn get(*this): i32;\n};\n\n' $i
+        printf 'type S%d = struct(T%d) {\n    value: i32;\n};\n\n' $i $i
+        printf 'fn S%d::get(*this): i32 {\n    return this->value;\n}\n\n' $i
+        printf 'fn use%d(let t: *T%d): i32 {\n    return t->get();\n}\n\n' $i $i
+    done
+    printf 'fn main(): i32 {\n    var sum: i32 = 0;\n'
+    for ((i = 0; i < $1; i++)); do
+        printf '    let s%d = S%d{%d};\n    sum = sum + use%d(&s%d);\n' $i $i $i $i $i
+    done
+    printf '    return sum;\n}\n'
+}
+
+# N files, each importing the one before it and the one halfway to the start, with main importing the last.
+gen_imports() {
+    for ((i = 0; i < $1; i++)); do
+        {
+            if ((i > 0)); then
+                printf 'import "m%d.kd";\nimport "m%d.kd";\n\n' $((i - 1)) $((i / 2))
+            fi
+            printf 'fn g%d(let x: i32): i32 {\n' $i
+            if ((i > 0)); then
+                printf '    return g%d(x) + 1;\n}\n' $((i - 1))
+            else
+                printf '    return x;\n}\n'
+            fi
+        } > m$i.kd
+    done
+    printf 'import "m%d.kd";\n\nfn main(): i32 {\n    return g%d(0);\n}\n' $(($1 - 1)) $(($1 - 1))
+}
+
+BENCHMARKS=(
+    "functions gen_functions $((2000 * SCALE))"
+    "expression gen_expression $((2000 * SCALE))"
+    "if_chain gen_if_chain $((1000 * SCALE))"
+    "types gen_types $((300 * SCALE))"
+    "imports gen_imports $((200 * SCALE))"
+)
+
+COMMIT=$(git -C "$(dirname $0)" rev-parse --short HEAD 2>/dev/null || echo unknown)
+JSON_ENTRIES=()
+printf '%-12s %6s %10s %10s %10s %10s %10s %10s %10s\n' benchmark size parse irgen passes lowering codegen total \
+    "rss (KiB)"
+for benchmark in "${BENCHMARKS[@]}"; do
+    read -r NAME GENERATOR SIZE <<< "$benchmark"
+    DIR=$WORK_DIR/$NAME
+    mkdir -p $DIR
+    (cd $DIR && $GENERATOR $SIZE > main.kd)
+
+    # Take the fastest of the runs for each phase, and the largest peak RSS.
+    declare -A BEST=()
+    BEST_RSS=0
+    for ((run = 0; run < RUNS; run++)); do
+        STATS=$(cd $DIR && $COMPILER build main.kd --print-stats $FLAGS)
+        if [ $? -ne 0 ]; then
+            printf "\u001b[31m%s failed to build\u001b[0m\n" $NAME
+            echo "$STATS"
+            exit 1
+        fi
+        while IFS='|' read -r PHASE TIME; do
+            if [ -z "${BEST[$PHASE]}" ] || awk "BEGIN { exit !($TIME < ${BEST[$PHASE]}) }"; then
+                BEST[$PHASE]=$TIME
+            fi
+        done < <(echo "$STATS" | sed -n 's/^\(.*\) took \([0-9.]*\) ms$/\1|\2/p')
+        RSS=$(echo "$STATS" | sed -n 's/^memory: peak rss was \([0-9]*\) KiB$/\1/p')
+        ((${RSS:-0} > BEST_RSS)) && BEST_RSS=$RSS
+    done
+
+    # Older compilers don't time every phase, so missing phases are left out of the total and written as null.
+    PHASES=("frontend: parsing" "frontend: ir generation" "passes: running passes" "llvm: lowering"
+        "codegen: emitting objects")
+    KEYS=(parse ir_gen passes lowering codegen)
+    TABLE_ROW=$(printf '%-12s %6d' $NAME $SIZE)
+    JSON_ENTRY=$(printf '    {"name": "%s", "size": %d' $NAME $SIZE)
+    TOTAL=0
+    for ((i = 0; i < ${#PHASES[@]}; i++)); do
+        KEY=${KEYS[$i]}
+        TIME=${BEST[${PHASES[$i]}]}
+        if [ -z "$TIME" ]; then
+            TABLE_ROW+=$(printf ' %10s' -)
+            JSON_ENTRY+=$(printf ', "%s_ms": null' $KEY)
+        else
+            TABLE_ROW+=$(printf ' %10.2f' $TIME)
+            JSON_ENTRY+=$(printf ', "%s_ms": %s' $KEY $TIME)
+            TOTAL=$(awk "BEGIN { printf \"%.2f\", $TOTAL + $TIME }")
+        fi
+    done
+    echo "$TABLE_ROW $(printf '%10.2f %10d' $TOTAL $BEST_RSS)"
+    JSON_ENTRIES+=("$JSON_ENTRY$(printf ', "total_ms": %s, "peak_rss_kib": %d}' $TOTAL $BEST_RSS)")
+    unset BEST
+done
+
+{
+    printf '{\n  "commit": "%s",\n  "flags": "%s",\n  "scale": %d,\n  "runs": %d,\n  "benchmarks": [\n' $COMMIT "$FLAGS" $SCALE \
+        $RUNS
+    for ((i = 0; i < ${#JSON_ENTRIES[@]}; i++)); do
+        printf '%s' "${JSON_ENTRIES[$i]}"
+        ((i + 1 < ${#JSON_ENTRIES[@]})) && printf ','
+        printf '\n'
+    done
+    printf '  ]\n}\n'
+} > $RESULTS
+echo "Results written to $RESULTS"
@@ -0,0 +1,269 @@
+#include <CfgSimplifier.hh>
+
+#include <analyses/ControlFlowAnalysis.hh>
+#include <analyses/MemorySsaAnalysis.hh>
+#include <analyses/ReachingDefAnalysis.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <pass/PassManager.hh>
+#include <support/Assert.hh>
+#include <support/Stack.hh>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+bool is_terminator(const ir::Instruction *inst) {
+    return inst->kind() == ir::InstKind::Branch || inst->kind() == ir::InstKind::CondBranch ||
+           inst->kind() == ir::InstKind::Ret;
+}
+
+std::vector<ir::BasicBlock *> succs(ir::BasicBlock *block) {
+    auto *terminator = block->terminator();
+    if (auto *branch = terminator->as_or_null<ir::BranchInst>()) {
+        return {branch->dst()};
+    }
+    if (auto *cond_branch = terminator->as_or_null<ir::CondBranchInst>()) {
+        return {cond_branch->true_dst(), cond_branch->false_dst()};
+    }
+    return {};
+}
+
+bool has_phis(ir::BasicBlock *block) {
+    return !block->empty() && (*block->begin())->kind() == ir::InstKind::Phi;
+}
+
+// Erases every instruction in `block` (back to front). Values still used elsewhere are replaced with undef.
+void clear_block(ir::BasicBlock *block) {
+    while (!block->empty()) {
+        auto *inst = block->terminator();
+        if (!inst->users().empty()) {
+            inst->replace_all_uses_with(ir::Undef::get(inst->type()));
+        }
+        inst->remove_from_parent();
+    }
+}
+
+class Simplifier {
+    ir::Function *const m_function;
+    std::unordered_map<ir::BasicBlock *, std::vector<ir::BasicBlock *>> m_preds;
+
+    void compute_preds();
+    bool fold_cond_branches();
+    bool merge_blocks();
+    bool remove_dead_tails();
+    bool remove_forwarding_blocks();
+    bool remove_unreachable_blocks();
+
+public:
+    explicit Simplifier(ir::Function *function) : m_function(function) {}
+
+    bool can_simplify() const;
+    bool simplify();
+};
+
+bool Simplifier::can_simplify() const {
+    // Blocks without a terminator implicitly fall through to the next block in LLVMGen, which we don't model here.
+    for (auto *block : *m_function) {
+        if (block->empty()) {
+            return false;
+        }
+        bool terminated = false;
+        for (auto *inst : *block) {
+            terminated |= is_terminator(inst);
+        }
+        if (!terminated) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Simplifier::compute_preds() {
+    m_preds.clear();
+    for (auto *block : *m_function) {
+        for (auto *succ : succs(block)) {
+            m_preds[succ].push_back(block);
+        }
+    }
+}
+
+bool Simplifier::remove_dead_tails() {
+    bool changed = false;
+    for (auto *block : *m_function) {
+        auto it = block->begin();
+        while (!is_terminator(*it)) {
+            ++it;
+        }
+        auto *terminator = *it;
+        while (block->terminator() != terminator) {
+            auto *inst = block->terminator();
+            if (!inst->users().empty()) {
+                inst->replace_all_uses_with(ir::Undef::get(inst->type()));
+            }
+            inst->remove_from_parent();
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool Simplifier::remove_unreachable_blocks() {
+    std::unordered_set<ir::BasicBlock *> reachable;
+    Stack<ir::BasicBlock *> work_list;
+    reachable.insert(m_function->entry());
+    work_list.push(m_function->entry());
+    while (!work_list.empty()) {
+        for (auto *succ : succs(work_list.pop())) {
+            if (reachable.insert(succ).second) {
+                work_list.push(succ);
+            }
+        }
+    }
+
+    std::vector<ir::BasicBlock *> unreachable;
+    for (auto *block : *m_function) {
+        if (!reachable.contains(block)) {
+            unreachable.push_back(block);
+        }
+    }
+    if (unreachable.empty()) {
+        return false;
+    }
+
+    // Detach the unreachable blocks from the phis of reachable blocks, then erase their instructions before erasing
+    // the blocks themselves, since they may branch to each other.
+    for (auto *block : unreachable) {
+        for (auto *succ : succs(block)) {
+            if (!reachable.contains(succ)) {
+                continue;
+            }
+            for (auto *inst : *succ) {
+                auto *phi = inst->as_or_null<ir::PhiInst>();
+                if (phi != nullptr && phi->incoming().contains(block)) {
+                    phi->remove_incoming(block);
+                }
+            }
+        }
+    }
+    for (auto *block : unreachable) {
+        clear_block(block);
+    }
+    for (auto *block : unreachable) {
+        m_function->remove_block(block);
+    }
+    return true;
+}
+
+bool Simplifier::fold_cond_branches() {
+    bool changed = false;
+    for (auto *block : *m_function) {
+        auto *cond_branch = block->terminator()->as_or_null<ir::CondBranchInst>();
+        if (cond_branch == nullptr || cond_branch->true_dst() != cond_branch->false_dst()) {
+            continue;
+        }
+        block->insert<ir::BranchInst>(block->position(cond_branch), cond_branch->true_dst());
+        cond_branch->remove_from_parent();
+        changed = true;
+    }
+    return changed;
+}
+
+bool Simplifier::remove_forwarding_blocks() {
+    bool changed = false;
+    for (auto it = m_function->begin(); it != m_function->end();) {
+        auto *block = *it;
+        ++it;
+        if (block == m_function->entry() || *block->begin() != block->terminator()) {
+            continue;
+        }
+        auto *branch = block->terminator()->as_or_null<ir::BranchInst>();
+        if (branch == nullptr || branch->dst() == block) {
+            continue;
+        }
+        // Forwarding into a block with phis would require merging incoming values, leave it for LLVM.
+        auto *dst = branch->dst();
+        if (has_phis(dst)) {
+            continue;
+        }
+        branch->remove_from_parent();
+        block->replace_all_uses_with(dst);
+        m_function->remove_block(block);
+        changed = true;
+    }
+    return changed;
+}
+
+bool Simplifier::merge_blocks() {
+    bool changed = false;
+    compute_preds();
+    for (auto *block : *m_function) {
+        // Keep merging successors into this block for as long as possible.
+        while (true) {
+            auto *branch = block->terminator()->as_or_null<ir::BranchInst>();
+            if (branch == nullptr) {
+                break;
+            }
+            auto *succ = branch->dst();
+            if (succ == block || succ == m_function->entry() || m_preds[succ].size() != 1) {
+                break;
+            }
+
+            // The successor only has one predecessor, so any phis must have a single incoming value.
+            while (has_phis(succ)) {
+                auto *phi = (*succ->begin())->as<ir::PhiInst>();
+                ASSERT(phi->incoming().size() == 1);
+                phi->replace_all_uses_with(phi->incoming().begin()->second);
+                phi->remove_from_parent();
+            }
+            branch->remove_from_parent();
+            block->splice(block->end(), succ);
+            for (auto *new_succ : succs(block)) {
+                std::replace(m_preds[new_succ].begin(), m_preds[new_succ].end(), succ, block);
+            }
+            succ->replace_all_uses_with(block);
+            m_preds.erase(succ);
+            m_function->remove_block(succ);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool Simplifier::simplify() {
+    bool changed = remove_dead_tails();
+    bool iteration_changed = true;
+    while (iteration_changed) {
+        iteration_changed = remove_unreachable_blocks();
+        iteration_changed |= fold_cond_branches();
+        iteration_changed |= remove_forwarding_blocks();
+        iteration_changed |= merge_blocks();
+        changed |= iteration_changed;
+    }
+    return changed;
+}
+
+} // namespace
+
+void CfgSimplifier::run(ir::Function *function) {
+    if (function->begin() == function->end()) {
+        return;
+    }
+
+    Simplifier simplifier(function);
+    if (!simplifier.can_simplify()) {
+        return;
+    }
+
+    // Memory phis hold uses of blocks, so the reaching definitions must be dropped before any blocks are removed.
+    m_manager->invalidate<MemorySsaAnalysis>(function);
+    m_manager->invalidate<ReachingDefAnalysis>(function);
+    if (simplifier.simplify()) {
+        m_manager->invalidate<ControlFlowAnalysis>(function);
+    }
+}
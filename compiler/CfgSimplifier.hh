@@ -0,0 +1,12 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+/// @brief Simplifies the control flow graph of a function.
+/// @details Removes instructions after a terminator and unreachable blocks, folds conditional branches with identical
+/// destinations, removes empty forwarding blocks and merges blocks with their single successor.
+struct CfgSimplifier : public Pass {
+    constexpr explicit CfgSimplifier(PassManager *manager) : Pass(manager) {}
+
+    void run(ir::Function *) override;
+};
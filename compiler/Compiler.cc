@@ -9,35 +9,94 @@
 
 #include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+// Standard library imports are relative to the kodo root.
+std::string resolve_path(const std::string &path) {
+    return path.starts_with("std") ? ROOT_PATH + path : path;
+}
+
+} // namespace
+
+const ast::Root *ParseCache::lookup(const std::string &path, const std::string &source) const {
+    auto it = m_entries.find(path);
+    return it != m_entries.end() && it->second.source == source ? *it->second.root : nullptr;
+}
+
+const ast::Root *ParseCache::store(const std::string &path, std::string source, Box<ast::Root> &&root) {
+    auto &entry = m_entries[path];
+    entry.source = std::move(source);
+    entry.root = std::move(root);
+    return *entry.root;
+}
 
 void Compiler::add_code(const std::string &path) {
     if (!m_visited.insert(path).second) {
         return;
     }
 
-    bool std = path.starts_with("std");
-    std::ifstream ifstream(std ? ROOT_PATH + path : path);
+    auto full_path = resolve_path(path);
+    std::ifstream ifstream(full_path);
     if (!ifstream) {
         print_error_and_abort("Could not open file {}", path);
     }
-    CharStream stream(&ifstream);
-    Lexer lexer(&stream);
-    Parser parser(&lexer);
-    auto root = parser.parse();
+    m_sources.emplace_back(std::istreambuf_iterator<char>(ifstream), std::istreambuf_iterator<char>());
+    bool cacheable = m_parse_cache != nullptr && path.starts_with("std");
+    const ast::Root *root = cacheable ? m_parse_cache->lookup(full_path, m_sources.back()) : nullptr;
+    if (root == nullptr) {
+        std::istringstream istream(m_sources.back());
+        CharStream stream(&istream);
+        Lexer lexer(&stream);
+        Parser parser(&lexer);
+        auto parsed_root = parser.parse();
+        parsed_root->set_path(full_path);
+        if (cacheable) {
+            root = m_parse_cache->store(full_path, m_sources.back(), std::move(parsed_root));
+        } else {
+            root = *parsed_root;
+            m_owned_roots.push_back(std::move(parsed_root));
+        }
+    }
+    SourceFile file{std::move(full_path), m_sources.back(), {}};
     for (const auto *decl : root->decls()) {
         const auto *import_stmt = decl->as_or_null<ast::ImportStmt>();
         if (import_stmt == nullptr) {
             continue;
         }
         add_code(import_stmt->path());
+        file.imports.push_back(resolve_path(import_stmt->path()));
     }
-    m_roots.push_back(std::move(root));
+    m_roots.push_back(root);
+    m_files.push_back(std::move(file));
 }
 
-Box<ir::Program> Compiler::compile(const std::string &main_path, bool freestanding) {
+void Compiler::parse(const std::string &main_path, bool freestanding, bool profile) {
+    // The profile runtime is called by _start, so must come first.
+    if (profile) {
+        add_code("std/profile.kd");
+    }
     if (!freestanding) {
         add_code("std/start.kd");
     }
     add_code(main_path);
-    return gen_ir(std::move(m_roots));
+}
+
+void parse_std_library(ParseCache &parse_cache) {
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(resolve_path("std"), ec)) {
+        if (entry.path().extension() == ".kd") {
+            Compiler compiler(&parse_cache);
+            compiler.parse("std/" + entry.path().filename().string(), true);
+        }
+    }
+}
+
+Box<ir::Program> Compiler::compile(bool lazy_bodies) {
+    auto program = gen_ir(m_roots, lazy_bodies);
+    m_roots.clear();
+    m_owned_roots.clear();
+    return program;
 }
@@ -5,15 +5,60 @@
 #include <support/Box.hh>
 
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+/// @brief A parsed source file.
+struct SourceFile {
+    // The full path, which is also the file of the functions it defines.
+    std::string path;
+    std::string source;
+    // The full paths of the files it directly imports.
+    std::vector<std::string> imports;
+};
+
+/// @brief Parsed standard library files, kept between compilations by `kodoc serve`.
+/// @details A file is only reused while its contents are unchanged.
+class ParseCache {
+    struct Entry {
+        std::string source;
+        Box<ast::Root> root;
+    };
+    std::unordered_map<std::string, Entry> m_entries;
+
+public:
+    const ast::Root *lookup(const std::string &path, const std::string &source) const;
+    const ast::Root *store(const std::string &path, std::string source, Box<ast::Root> &&root);
+};
+
+/// @brief Parses every file in the standard library into `parse_cache`, reusing entries whose files haven't changed.
+void parse_std_library(ParseCache &parse_cache);
+
 class Compiler {
+    ParseCache *const m_parse_cache;
     std::unordered_set<std::string> m_visited;
-    std::vector<Box<ast::Root>> m_roots;
+    std::vector<const ast::Root *> m_roots;
+    std::vector<Box<ast::Root>> m_owned_roots;
+    std::vector<std::string> m_sources;
+    std::vector<SourceFile> m_files;
 
     void add_code(const std::string &path);
 
 public:
-    Box<ir::Program> compile(const std::string &main_path, bool freestanding);
+    explicit Compiler(ParseCache *parse_cache = nullptr) : m_parse_cache(parse_cache) {}
+
+    /// @brief Parses the main file and everything it (transitively) imports.
+    /// @param profile Whether to include the runtime needed by --profile-generate.
+    void parse(const std::string &main_path, bool freestanding, bool profile = false);
+
+    /// @brief Generates IR for the parsed files.
+    /// @param lazy_bodies Whether to only lower the bodies of imported functions which are used.
+    Box<ir::Program> compile(bool lazy_bodies = true);
+
+    /// @brief The contents of every parsed file, in the order they were parsed.
+    const std::vector<std::string> &sources() const { return m_sources; }
+
+    /// @brief Every parsed file, with imported files before the files importing them.
+    const std::vector<SourceFile> &files() const { return m_files; }
 };
@@ -1,13 +1,17 @@
 #include <ConcreteImplementer.hh>
 
+#include <Remarks.hh>
 #include <ir/Constants.hh>
 #include <ir/Function.hh>
 #include <ir/Instructions.hh>
 #include <ir/Program.hh>
 #include <ir/Prototype.hh>
 #include <ir/Types.hh>
+#include <pass/PassManager.hh>
 #include <support/Error.hh>
 
+#include <fmt/core.h>
+
 #include <unordered_map>
 
 namespace {
@@ -100,6 +104,10 @@ void ConcreteImplementer::run(ir::Program *program) {
                         continue;
                     }
                     ++inst_it;
+                    if (auto *remarks = m_manager->remarks()) {
+                        remarks->emit(RemarkKind::Missed, "concrete-implementer", "VirtualCall", function,
+                                      call->line(), fmt::format("call to '{}' goes through a vtable", it->name()));
+                    }
                     auto position = block->position(call);
                     std::vector<ir::Value *> indices;
                     indices.push_back(
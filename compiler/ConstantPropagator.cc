@@ -0,0 +1,400 @@
+#include <ConstantPropagator.hh>
+
+#include <analyses/ControlFlowAnalysis.hh>
+#include <analyses/MemorySsaAnalysis.hh>
+#include <analyses/ReachingDefAnalysis.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <ir/Types.hh>
+#include <pass/PassManager.hh>
+#include <support/Assert.hh>
+#include <support/PairHash.hh>
+#include <support/Stack.hh>
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int bit_width(const ir::Type *type) {
+    type = ir::Type::base(type);
+    if (type->is<ir::BoolType>()) {
+        return 1;
+    }
+    if (const auto *int_type = type->as_or_null<ir::IntType>()) {
+        return int_type->bit_width();
+    }
+    return 0;
+}
+
+std::uint64_t truncate(std::uint64_t value, int bit_width) {
+    return bit_width < 64 ? value & ((std::uint64_t(1) << bit_width) - 1) : value;
+}
+
+std::int64_t sign_extend(std::uint64_t value, int bit_width) {
+    if (bit_width >= 64) {
+        return static_cast<std::int64_t>(value);
+    }
+    const auto sign_bit = std::uint64_t(1) << (bit_width - 1);
+    value = truncate(value, bit_width);
+    return static_cast<std::int64_t>((value ^ sign_bit) - sign_bit);
+}
+
+// The fold functions mirror the semantics of the LLVM instructions emitted by LLVMGen (signed division and signed
+// comparisons). They return nullptr if the operation can't be folded.
+ir::Constant *fold_binary(const ir::BinaryInst *binary, const ir::ConstantInt *lhs, const ir::ConstantInt *rhs) {
+    int width = bit_width(binary->type());
+    if (width == 0) {
+        return nullptr;
+    }
+    std::int64_t lhs_value = sign_extend(lhs->value(), width);
+    std::int64_t rhs_value = sign_extend(rhs->value(), width);
+    std::uint64_t result = 0;
+    switch (binary->op()) {
+    case ir::BinaryOp::Add:
+        result = static_cast<std::uint64_t>(lhs_value) + static_cast<std::uint64_t>(rhs_value);
+        break;
+    case ir::BinaryOp::Sub:
+        result = static_cast<std::uint64_t>(lhs_value) - static_cast<std::uint64_t>(rhs_value);
+        break;
+    case ir::BinaryOp::Mul:
+        result = static_cast<std::uint64_t>(lhs_value) * static_cast<std::uint64_t>(rhs_value);
+        break;
+    case ir::BinaryOp::Div:
+        // Division by zero and signed overflow are undefined, leave them for runtime.
+        if (rhs_value == 0 || (rhs_value == -1 && lhs_value == sign_extend(std::uint64_t(1) << (width - 1), width))) {
+            return nullptr;
+        }
+        result = static_cast<std::uint64_t>(lhs_value / rhs_value);
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+    return ir::ConstantInt::get(binary->type(), truncate(result, width));
+}
+
+ir::Constant *fold_cast(const ir::CastInst *cast, const ir::ConstantInt *val) {
+    int from_width = bit_width(val->type());
+    int to_width = bit_width(cast->type());
+    if (from_width == 0 || to_width == 0) {
+        return nullptr;
+    }
+    switch (cast->op()) {
+    case ir::CastOp::SignExtend:
+        if (from_width > to_width) {
+            return nullptr;
+        }
+        return ir::ConstantInt::get(cast->type(),
+                                    truncate(static_cast<std::uint64_t>(sign_extend(val->value(), from_width)), to_width));
+    case ir::CastOp::ZeroExtend:
+        if (from_width > to_width) {
+            return nullptr;
+        }
+        return ir::ConstantInt::get(cast->type(), truncate(val->value(), from_width));
+    case ir::CastOp::Truncate:
+        return ir::ConstantInt::get(cast->type(), truncate(val->value(), to_width));
+    default:
+        return nullptr;
+    }
+}
+
+ir::Constant *fold_compare(const ir::CompareInst *compare, const ir::ConstantInt *lhs, const ir::ConstantInt *rhs) {
+    int width = bit_width(lhs->type());
+    if (width == 0 || width != bit_width(rhs->type())) {
+        return nullptr;
+    }
+    std::int64_t lhs_value = sign_extend(lhs->value(), width);
+    std::int64_t rhs_value = sign_extend(rhs->value(), width);
+    bool result = false;
+    switch (compare->op()) {
+    case ir::CompareOp::LessThan:
+        result = lhs_value < rhs_value;
+        break;
+    case ir::CompareOp::GreaterThan:
+        result = lhs_value > rhs_value;
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+    return ir::ConstantInt::get(compare->type(), result ? 1 : 0);
+}
+
+class LatticeValue {
+public:
+    enum class State {
+        Unknown,
+        Constant,
+        Overdefined,
+    };
+
+private:
+    State m_state{State::Unknown};
+    ir::Constant *m_constant{nullptr};
+
+public:
+    LatticeValue() = default;
+    explicit LatticeValue(ir::Constant *constant) : m_state(State::Constant), m_constant(constant) {}
+    static LatticeValue overdefined() {
+        LatticeValue ret;
+        ret.m_state = State::Overdefined;
+        return ret;
+    }
+
+    bool operator==(const LatticeValue &) const = default;
+
+    State state() const { return m_state; }
+    ir::Constant *constant() const { return m_constant; }
+    bool is_constant() const { return m_state == State::Constant; }
+    bool is_overdefined() const { return m_state == State::Overdefined; }
+    bool is_unknown() const { return m_state == State::Unknown; }
+};
+
+class Propagator {
+    ir::Function *const m_function;
+    std::unordered_map<ir::Instruction *, LatticeValue> m_values;
+    std::unordered_set<ir::BasicBlock *> m_executable_blocks;
+    std::unordered_set<std::pair<ir::BasicBlock *, ir::BasicBlock *>, PairHash> m_executable_edges;
+    Stack<std::pair<ir::BasicBlock *, ir::BasicBlock *>> m_edge_work_list;
+    Stack<ir::Instruction *> m_inst_work_list;
+
+    LatticeValue lattice_value(ir::Value *value);
+    void mark(ir::Instruction *inst, LatticeValue value);
+    void mark_edge(ir::BasicBlock *src, ir::BasicBlock *dst);
+
+    void visit_binary(ir::BinaryInst *);
+    void visit_cast(ir::CastInst *);
+    void visit_compare(ir::CompareInst *);
+    void visit_cond_branch(ir::CondBranchInst *);
+    void visit_phi(ir::PhiInst *);
+    void visit(ir::Instruction *);
+
+public:
+    explicit Propagator(ir::Function *function) : m_function(function) {}
+
+    void solve();
+    bool rewrite();
+};
+
+LatticeValue Propagator::lattice_value(ir::Value *value) {
+    if (auto *constant = value->as_or_null<ir::Constant>()) {
+        if (constant->as_or_null<ir::ConstantInt>() != nullptr && bit_width(constant->type()) != 0) {
+            return LatticeValue(constant);
+        }
+        return LatticeValue::overdefined();
+    }
+    if (auto *inst = value->as_or_null<ir::Instruction>()) {
+        return m_values[inst];
+    }
+    return LatticeValue::overdefined();
+}
+
+void Propagator::mark(ir::Instruction *inst, LatticeValue value) {
+    auto &current = m_values[inst];
+    if (current == value || current.is_overdefined()) {
+        return;
+    }
+    // Lattice values can only move downwards. A constant meeting a different constant becomes overdefined.
+    current = current.is_constant() && value.is_constant() ? LatticeValue::overdefined() : value;
+    for (auto *user : inst->users()) {
+        if (auto *user_inst = user->as_or_null<ir::Instruction>()) {
+            m_inst_work_list.push(user_inst);
+        }
+    }
+}
+
+void Propagator::mark_edge(ir::BasicBlock *src, ir::BasicBlock *dst) {
+    if (m_executable_edges.emplace(src, dst).second) {
+        m_edge_work_list.push(std::make_pair(src, dst));
+    }
+}
+
+void Propagator::visit_binary(ir::BinaryInst *binary) {
+    auto lhs = lattice_value(binary->lhs());
+    auto rhs = lattice_value(binary->rhs());
+    if (lhs.is_overdefined() || rhs.is_overdefined()) {
+        mark(binary, LatticeValue::overdefined());
+    } else if (lhs.is_constant() && rhs.is_constant()) {
+        auto *folded = fold_binary(binary, lhs.constant()->as<ir::ConstantInt>(), rhs.constant()->as<ir::ConstantInt>());
+        mark(binary, folded != nullptr ? LatticeValue(folded) : LatticeValue::overdefined());
+    }
+}
+
+void Propagator::visit_cast(ir::CastInst *cast) {
+    auto val = lattice_value(cast->val());
+    if (val.is_overdefined()) {
+        mark(cast, LatticeValue::overdefined());
+    } else if (val.is_constant()) {
+        auto *folded = fold_cast(cast, val.constant()->as<ir::ConstantInt>());
+        mark(cast, folded != nullptr ? LatticeValue(folded) : LatticeValue::overdefined());
+    }
+}
+
+void Propagator::visit_compare(ir::CompareInst *compare) {
+    auto lhs = lattice_value(compare->lhs());
+    auto rhs = lattice_value(compare->rhs());
+    if (lhs.is_overdefined() || rhs.is_overdefined()) {
+        mark(compare, LatticeValue::overdefined());
+    } else if (lhs.is_constant() && rhs.is_constant()) {
+        auto *folded =
+            fold_compare(compare, lhs.constant()->as<ir::ConstantInt>(), rhs.constant()->as<ir::ConstantInt>());
+        mark(compare, folded != nullptr ? LatticeValue(folded) : LatticeValue::overdefined());
+    }
+}
+
+void Propagator::visit_cond_branch(ir::CondBranchInst *cond_branch) {
+    auto cond = lattice_value(cond_branch->cond());
+    if (cond.is_unknown()) {
+        return;
+    }
+    auto *block = cond_branch->parent();
+    if (cond.is_overdefined()) {
+        mark_edge(block, cond_branch->true_dst());
+        mark_edge(block, cond_branch->false_dst());
+        return;
+    }
+    bool taken = cond.constant()->as<ir::ConstantInt>()->value() != 0;
+    mark_edge(block, taken ? cond_branch->true_dst() : cond_branch->false_dst());
+}
+
+void Propagator::visit_phi(ir::PhiInst *phi) {
+    LatticeValue result;
+    for (auto [block, value] : phi->incoming()) {
+        if (!m_executable_edges.contains(std::make_pair(block, phi->parent()))) {
+            continue;
+        }
+        auto incoming = value != nullptr ? lattice_value(value) : LatticeValue::overdefined();
+        if (incoming.is_unknown()) {
+            continue;
+        }
+        if (incoming.is_overdefined() || (result.is_constant() && result != incoming)) {
+            result = LatticeValue::overdefined();
+            break;
+        }
+        result = incoming;
+    }
+    if (!result.is_unknown()) {
+        mark(phi, result);
+    }
+}
+
+void Propagator::visit(ir::Instruction *inst) {
+    switch (inst->kind()) {
+    case ir::InstKind::Binary:
+        visit_binary(inst->as<ir::BinaryInst>());
+        break;
+    case ir::InstKind::Branch:
+        mark_edge(inst->parent(), inst->as<ir::BranchInst>()->dst());
+        break;
+    case ir::InstKind::Cast:
+        visit_cast(inst->as<ir::CastInst>());
+        break;
+    case ir::InstKind::Compare:
+        visit_compare(inst->as<ir::CompareInst>());
+        break;
+    case ir::InstKind::CondBranch:
+        visit_cond_branch(inst->as<ir::CondBranchInst>());
+        break;
+    case ir::InstKind::Phi:
+        visit_phi(inst->as<ir::PhiInst>());
+        break;
+    default:
+        // Anything else (calls, loads, inline asm, etc.) may produce any value.
+        mark(inst, LatticeValue::overdefined());
+        break;
+    }
+}
+
+void Propagator::solve() {
+    auto *entry = m_function->entry();
+    m_executable_blocks.insert(entry);
+    for (auto *inst : *entry) {
+        visit(inst);
+    }
+    while (!m_edge_work_list.empty() || !m_inst_work_list.empty()) {
+        while (!m_inst_work_list.empty()) {
+            auto *inst = m_inst_work_list.pop();
+            if (m_executable_blocks.contains(inst->parent())) {
+                visit(inst);
+            }
+        }
+        while (!m_edge_work_list.empty()) {
+            auto *dst = m_edge_work_list.pop().second;
+            if (!m_executable_blocks.insert(dst).second) {
+                // The block has already been visited, only the phis need to be reevaluated for the new edge.
+                for (auto *inst : *dst) {
+                    if (auto *phi = inst->as_or_null<ir::PhiInst>()) {
+                        visit_phi(phi);
+                    }
+                }
+                continue;
+            }
+            for (auto *inst : *dst) {
+                visit(inst);
+            }
+        }
+    }
+}
+
+bool Propagator::rewrite() {
+    bool changed = false;
+    for (auto *block : *m_function) {
+        for (auto it = block->begin(); it != block->end();) {
+            auto *inst = *it;
+            ++it;
+            auto value = m_values[inst];
+            if (!value.is_constant()) {
+                continue;
+            }
+            inst->replace_all_uses_with(value.constant());
+            inst->remove_from_parent();
+            changed = true;
+        }
+    }
+
+    for (auto *block : *m_function) {
+        if (block->empty()) {
+            continue;
+        }
+        auto *cond_branch = block->terminator()->as_or_null<ir::CondBranchInst>();
+        auto *cond = cond_branch != nullptr ? cond_branch->cond()->as_or_null<ir::Constant>() : nullptr;
+        if (cond == nullptr || cond->as_or_null<ir::ConstantInt>() == nullptr) {
+            continue;
+        }
+        bool taken = cond->as<ir::ConstantInt>()->value() != 0;
+        auto *dst = taken ? cond_branch->true_dst() : cond_branch->false_dst();
+        auto *dead_dst = taken ? cond_branch->false_dst() : cond_branch->true_dst();
+        if (dead_dst != dst) {
+            for (auto *inst : *dead_dst) {
+                auto *phi = inst->as_or_null<ir::PhiInst>();
+                if (phi != nullptr && phi->incoming().contains(block)) {
+                    phi->remove_incoming(block);
+                }
+            }
+        }
+        block->insert<ir::BranchInst>(block->position(cond_branch), dst);
+        cond_branch->remove_from_parent();
+        changed = true;
+    }
+    return changed;
+}
+
+} // namespace
+
+void ConstantPropagator::run(ir::Function *function) {
+    if (function->begin() == function->end()) {
+        return;
+    }
+
+    Propagator propagator(function);
+    propagator.solve();
+    if (propagator.rewrite()) {
+        m_manager->invalidate<ControlFlowAnalysis>(function);
+        m_manager->invalidate<MemorySsaAnalysis>(function);
+        m_manager->invalidate<ReachingDefAnalysis>(function);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+/// @brief Sparse conditional constant propagation.
+/// @details Folds arithmetic, comparisons and casts of constants, and turns conditional branches on constant conditions
+/// into unconditional branches. Blocks which become unreachable are left in place.
+struct ConstantPropagator : public Pass {
+    constexpr explicit ConstantPropagator(PassManager *manager) : Pass(manager) {}
+
+    void run(ir::Function *) override;
+};
@@ -0,0 +1,145 @@
+#include <DeadCodeEliminator.hh>
+
+#include <analyses/MemorySsaAnalysis.hh>
+#include <analyses/ReachingDefAnalysis.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <pass/PassManager.hh>
+#include <support/Assert.hh>
+#include <support/Stack.hh>
+
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+bool has_side_effects(const ir::Instruction *inst) {
+    switch (inst->kind()) {
+    case ir::InstKind::Branch:
+    case ir::InstKind::Call:
+    case ir::InstKind::CondBranch:
+    case ir::InstKind::Copy:
+    case ir::InstKind::InlineAsm:
+    case ir::InstKind::Ret:
+    case ir::InstKind::Store:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::vector<ir::Value *> operands(ir::Instruction *inst) {
+    switch (inst->kind()) {
+    case ir::InstKind::Binary:
+        return {inst->as<ir::BinaryInst>()->lhs(), inst->as<ir::BinaryInst>()->rhs()};
+    case ir::InstKind::Call: {
+        auto *call = inst->as<ir::CallInst>();
+        std::vector<ir::Value *> ret(call->args());
+        ret.push_back(call->callee());
+        return ret;
+    }
+    case ir::InstKind::Cast:
+        return {inst->as<ir::CastInst>()->val()};
+    case ir::InstKind::Compare:
+        return {inst->as<ir::CompareInst>()->lhs(), inst->as<ir::CompareInst>()->rhs()};
+    case ir::InstKind::CondBranch:
+        return {inst->as<ir::CondBranchInst>()->cond()};
+    case ir::InstKind::Copy: {
+        auto *copy = inst->as<ir::CopyInst>();
+        return {copy->dst(), copy->src(), copy->len()};
+    }
+    case ir::InstKind::InlineAsm: {
+        auto *inline_asm = inst->as<ir::InlineAsmInst>();
+        std::vector<ir::Value *> ret;
+        for (const auto &[input, value] : inline_asm->inputs()) {
+            ret.push_back(value);
+        }
+        for (const auto &[output, value] : inline_asm->outputs()) {
+            ret.push_back(value);
+        }
+        return ret;
+    }
+    case ir::InstKind::Lea: {
+        auto *lea = inst->as<ir::LeaInst>();
+        std::vector<ir::Value *> ret(lea->indices());
+        ret.push_back(lea->ptr());
+        return ret;
+    }
+    case ir::InstKind::Load:
+        return {inst->as<ir::LoadInst>()->ptr()};
+    case ir::InstKind::Phi: {
+        std::vector<ir::Value *> ret;
+        for (auto [block, value] : inst->as<ir::PhiInst>()->incoming()) {
+            ret.push_back(value);
+        }
+        return ret;
+    }
+    case ir::InstKind::Store:
+        return {inst->as<ir::StoreInst>()->ptr(), inst->as<ir::StoreInst>()->val()};
+    case ir::InstKind::Ret:
+        return {inst->as<ir::RetInst>()->val()};
+    default:
+        return {};
+    }
+}
+
+} // namespace
+
+void DeadCodeEliminator::run(ir::Function *function) {
+    if (function->begin() == function->end()) {
+        return;
+    }
+
+    // Mark all instructions with side effects as live, and then everything they depend on.
+    std::unordered_set<ir::Instruction *> live;
+    Stack<ir::Instruction *> work_list;
+    for (auto *block : *function) {
+        for (auto *inst : *block) {
+            if (has_side_effects(inst)) {
+                live.insert(inst);
+                work_list.push(inst);
+            }
+        }
+    }
+    while (!work_list.empty()) {
+        auto *inst = work_list.pop();
+        for (auto *operand : operands(inst)) {
+            auto *operand_inst = operand != nullptr ? operand->as_or_null<ir::Instruction>() : nullptr;
+            if (operand_inst != nullptr && live.insert(operand_inst).second) {
+                work_list.push(operand_inst);
+            }
+        }
+    }
+
+    std::vector<ir::Instruction *> dead;
+    for (auto *block : *function) {
+        for (auto *inst : *block) {
+            if (!live.contains(inst)) {
+                dead.push_back(inst);
+            }
+        }
+    }
+    if (dead.empty()) {
+        return;
+    }
+
+    // Dead instructions can only be used by other dead instructions, so the uses can be dropped before removal.
+    m_manager->invalidate<MemorySsaAnalysis>(function);
+    m_manager->invalidate<ReachingDefAnalysis>(function);
+    for (auto *inst : dead) {
+        inst->replace_all_uses_with(nullptr);
+    }
+    for (auto *inst : dead) {
+        inst->remove_from_parent();
+    }
+    std::vector<ir::LocalVar *> dead_vars;
+    for (auto *var : function->vars()) {
+        if (var->users().empty()) {
+            dead_vars.push_back(var);
+        }
+    }
+    for (auto *var : dead_vars) {
+        function->remove_var(var);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+/// @brief Aggressive dead code elimination.
+/// @details Assumes every instruction is dead unless it has side effects or is (transitively) used by an instruction
+/// with side effects. This also removes dead cycles of phis which a simple use count check would miss.
+struct DeadCodeEliminator : public Pass {
+    constexpr explicit DeadCodeEliminator(PassManager *manager) : Pass(manager) {}
+
+    void run(ir::Function *) override;
+};
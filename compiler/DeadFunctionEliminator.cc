@@ -0,0 +1,99 @@
+#include <DeadFunctionEliminator.hh>
+
+#include <Profile.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/Function.hh>
+#include <ir/GlobalVariable.hh>
+#include <ir/Instruction.hh>
+#include <ir/Program.hh>
+#include <ir/Prototype.hh>
+#include <pass/PassManager.hh>
+
+#include <fmt/core.h>
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+void DeadFunctionEliminator::run(ir::Program *program) {
+    std::unordered_map<std::string, ir::Function *> definitions;
+    for (auto *function : *program) {
+        if (!function->prototype()->externed()) {
+            definitions.emplace(function->name(), function);
+        }
+    }
+
+    // Build the reference graph, mapping each function and global to the functions and globals it references.
+    std::unordered_map<const ir::Value *, std::vector<ir::Value *>> references;
+    auto add_referencing_functions = [&](ir::Value *value) {
+        for (auto *user : value->users()) {
+            if (auto *inst = user->as_or_null<ir::Instruction>()) {
+                references[inst->parent()->parent()].push_back(value);
+            }
+        }
+    };
+    for (auto *function : *program) {
+        add_referencing_functions(function);
+        if (auto it = definitions.find(function->name()); it != definitions.end() && it->second != function) {
+            references[function].push_back(it->second);
+        }
+    }
+    for (auto *global : program->globals()) {
+        add_referencing_functions(global);
+        if (const auto *vtable = global->initialiser()->as_or_null<ir::ConstantArray>()) {
+            for (auto *elem : vtable->elems()) {
+                if (elem->is<ir::Function>()) {
+                    references[global].push_back(elem);
+                }
+            }
+        }
+    }
+
+    std::unordered_set<const ir::Value *> reachable;
+    std::vector<const ir::Value *> work_list;
+    for (const char *entry_point : {"_start", "main", k_profile_write_function}) {
+        if (auto it = definitions.find(entry_point); it != definitions.end()) {
+            reachable.insert(it->second);
+            work_list.push_back(it->second);
+        }
+    }
+    // Without an entry point, there is no way to tell what is used.
+    if (work_list.empty()) {
+        return;
+    }
+    while (!work_list.empty()) {
+        const auto *value = work_list.back();
+        work_list.pop_back();
+        for (auto *referenced : references[value]) {
+            if (reachable.insert(referenced).second) {
+                work_list.push_back(referenced);
+            }
+        }
+    }
+
+    // Remove functions first, since globals may be used by dead functions, but not the other way around.
+    std::vector<ir::Function *> dead_functions;
+    for (auto *function : *program) {
+        if (!reachable.contains(function)) {
+            dead_functions.push_back(function);
+        }
+    }
+    std::vector<ir::GlobalVariable *> dead_globals;
+    for (auto *global : program->globals()) {
+        if (!reachable.contains(global)) {
+            dead_globals.push_back(global);
+        }
+    }
+    for (auto *function : dead_functions) {
+        m_manager->forget(function);
+        program->remove_function(function);
+    }
+    for (auto *global : dead_globals) {
+        program->remove_global(global);
+    }
+    if (m_print_stats) {
+        fmt::print("dfe: removed {} dead functions and {} dead globals\n", dead_functions.size(), dead_globals.size());
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+/// @brief Removes functions and globals which can't be reached from the program's entry points.
+/// @details The entry points are `_start`, `main` and the profile runtime, which instrumented programs call. Anything
+/// referenced by a reachable function is reachable, as are the functions in a reachable vtable and the definition of a
+/// reachable extern declaration. Constant strings are only emitted when used, so go along with their users.
+class DeadFunctionEliminator : public Pass {
+    const bool m_print_stats;
+
+public:
+    constexpr DeadFunctionEliminator(PassManager *manager, bool print_stats)
+        : Pass(manager), m_print_stats(print_stats) {}
+
+    void run(ir::Program *) override;
+};
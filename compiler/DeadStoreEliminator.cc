@@ -0,0 +1,132 @@
+#include <DeadStoreEliminator.hh>
+
+#include <analyses/AliasAnalysis.hh>
+#include <analyses/ControlFlowAnalysis.hh>
+#include <analyses/MemorySsaAnalysis.hh>
+#include <analyses/ReachingDefAnalysis.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <ir/Program.hh>
+#include <pass/PassManager.hh>
+#include <pass/PassUsage.hh>
+
+#include <fmt/core.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+class Eliminator {
+    const AliasAnalysis *const m_aa;
+    const ControlFlowAnalysis *const m_cfa;
+
+    bool is_dead_from(ir::BasicBlock *block, ir::BasicBlock::iterator it, ir::Value *ptr,
+                      std::unordered_map<ir::BasicBlock *, bool> &visited) const;
+    bool is_overwritten_by(ir::Instruction *inst, ir::Value *ptr) const;
+
+public:
+    Eliminator(const AliasAnalysis *aa, const ControlFlowAnalysis *cfa) : m_aa(aa), m_cfa(cfa) {}
+
+    bool is_dead(ir::Instruction *inst, ir::Value *ptr) const;
+};
+
+bool Eliminator::is_overwritten_by(ir::Instruction *inst, ir::Value *ptr) const {
+    if (auto *copy = inst->as_or_null<ir::CopyInst>()) {
+        return m_aa->alias(copy->dst(), ptr) == AliasResult::MustAlias;
+    }
+    if (auto *store = inst->as_or_null<ir::StoreInst>()) {
+        return m_aa->alias(store->ptr(), ptr) == AliasResult::MustAlias;
+    }
+    return false;
+}
+
+bool Eliminator::is_dead_from(ir::BasicBlock *block, ir::BasicBlock::iterator it, ir::Value *ptr,
+                              std::unordered_map<ir::BasicBlock *, bool> &visited) const {
+    for (; it != block->end(); ++it) {
+        auto *inst = *it;
+        if (m_aa->may_reference(inst, ptr)) {
+            return false;
+        }
+        if (is_overwritten_by(inst, ptr)) {
+            return true;
+        }
+        if (inst->as_or_null<ir::RetInst>() != nullptr) {
+            // Local variables don't outlive the function.
+            return m_aa->underlying_object(ptr)->as_or_null<ir::LocalVar>() != nullptr;
+        }
+        if (inst->as_or_null<ir::BranchInst>() != nullptr || inst->as_or_null<ir::CondBranchInst>() != nullptr) {
+            for (auto *succ : m_cfa->succs(block)) {
+                if (!visited.contains(succ)) {
+                    // Assume live whilst visiting to stay conservative should the CFG contain a cycle.
+                    visited.emplace(succ, false);
+                    visited[succ] = is_dead_from(succ, succ->begin(), ptr, visited);
+                }
+                if (!visited.at(succ)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+    // The block falls through to the next block, which isn't modelled by the CFG.
+    return false;
+}
+
+bool Eliminator::is_dead(ir::Instruction *inst, ir::Value *ptr) const {
+    auto *block = inst->parent();
+    std::unordered_map<ir::BasicBlock *, bool> visited;
+    return is_dead_from(block, ++block->position(inst), ptr, visited);
+}
+
+} // namespace
+
+void DeadStoreEliminator::build_usage(PassUsage *usage) {
+    usage->uses<AliasAnalysis>();
+    usage->uses<ControlFlowAnalysis>();
+}
+
+// Returns the number of stores and copies removed from `function`.
+std::size_t DeadStoreEliminator::eliminate(ir::Function *function) {
+    if (function->begin() == function->end()) {
+        return 0;
+    }
+
+    Eliminator eliminator(m_manager->get<AliasAnalysis>(function), m_manager->get<ControlFlowAnalysis>(function));
+    std::vector<ir::Instruction *> dead;
+    for (auto *block : *function) {
+        for (auto *inst : *block) {
+            if (auto *copy = inst->as_or_null<ir::CopyInst>()) {
+                if (eliminator.is_dead(copy, copy->dst())) {
+                    dead.push_back(copy);
+                }
+            } else if (auto *store = inst->as_or_null<ir::StoreInst>()) {
+                if (eliminator.is_dead(store, store->ptr())) {
+                    dead.push_back(store);
+                }
+            }
+        }
+    }
+    if (dead.empty()) {
+        return 0;
+    }
+
+    m_manager->invalidate<MemorySsaAnalysis>(function);
+    m_manager->invalidate<ReachingDefAnalysis>(function);
+    for (auto *inst : dead) {
+        inst->remove_from_parent();
+    }
+    return dead.size();
+}
+
+void DeadStoreEliminator::run(ir::Program *program) {
+    // Functions are handled here rather than in run(ir::Function *) so that a single total can be printed.
+    std::size_t removed_count = 0;
+    for (auto *function : *program) {
+        removed_count += eliminate(function);
+    }
+    if (m_print_stats) {
+        fmt::print("dse: removed {} dead stores\n", removed_count);
+    }
+}
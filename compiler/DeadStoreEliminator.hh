@@ -0,0 +1,21 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+#include <cstddef>
+
+/// @brief Removes stores and copies whose written memory is never observed.
+/// @details A write is dead if, on every path from it, the memory is overwritten before anything may read it, or the
+/// function returns and the memory belongs to a local variable.
+class DeadStoreEliminator : public Pass {
+    const bool m_print_stats;
+
+    std::size_t eliminate(ir::Function *function);
+
+public:
+    constexpr DeadStoreEliminator(PassManager *manager, bool print_stats)
+        : Pass(manager), m_print_stats(print_stats) {}
+
+    void build_usage(PassUsage *) override;
+    void run(ir::Program *) override;
+};
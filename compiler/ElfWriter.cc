@@ -0,0 +1,164 @@
+#include <ElfWriter.hh>
+
+#include <elf.h>
+
+#include <array>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+// The order of sections in the written object.
+enum SectionIndex : std::uint16_t {
+    Null,
+    Text,
+    Rodata,
+    RelaText,
+    RelaRodata,
+    Symtab,
+    Strtab,
+    Shstrtab,
+    NoteGnuStack,
+    Count,
+};
+
+class StringTable {
+    std::vector<char> m_data{'\0'};
+
+public:
+    std::uint32_t add(std::string_view string) {
+        auto offset = static_cast<std::uint32_t>(m_data.size());
+        m_data.insert(m_data.end(), string.begin(), string.end());
+        m_data.push_back('\0');
+        return offset;
+    }
+
+    const std::vector<char> &data() const { return m_data; }
+};
+
+template <typename T>
+void append(std::vector<char> &buffer, const T &value) {
+    const auto *bytes = reinterpret_cast<const char *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void align(std::vector<char> &buffer, std::size_t alignment) {
+    buffer.resize((buffer.size() + alignment - 1) / alignment * alignment);
+}
+
+} // namespace
+
+std::uint32_t ElfWriter::add_function(std::string name, std::uint64_t offset, std::uint64_t size) {
+    m_symbols.push_back({std::move(name), true, ElfSection::Text, offset, size});
+    return k_rodata_symbol + static_cast<std::uint32_t>(m_symbols.size());
+}
+
+std::uint32_t ElfWriter::add_undefined(std::string name) {
+    m_symbols.push_back({std::move(name), false, ElfSection::Text, 0, 0});
+    return k_rodata_symbol + static_cast<std::uint32_t>(m_symbols.size());
+}
+
+void ElfWriter::add_relocation(ElfSection section, std::uint64_t offset, std::uint32_t symbol, std::uint32_t type,
+                               std::int64_t addend) {
+    auto &relocations = section == ElfSection::Text ? m_text_relocations : m_rodata_relocations;
+    relocations.push_back({offset, symbol, type, addend});
+}
+
+std::vector<char> ElfWriter::write() const {
+    StringTable strtab;
+    std::vector<Elf64_Sym> symbols(k_rodata_symbol + 1);
+    symbols[k_text_symbol].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    symbols[k_text_symbol].st_shndx = SectionIndex::Text;
+    symbols[k_rodata_symbol].st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+    symbols[k_rodata_symbol].st_shndx = SectionIndex::Rodata;
+    for (const auto &symbol : m_symbols) {
+        auto &elf_symbol = symbols.emplace_back();
+        elf_symbol.st_name = strtab.add(symbol.name);
+        elf_symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, symbol.defined ? STT_FUNC : STT_NOTYPE);
+        elf_symbol.st_shndx = symbol.defined ? SectionIndex::Text : SHN_UNDEF;
+        elf_symbol.st_value = symbol.offset;
+        elf_symbol.st_size = symbol.size;
+    }
+
+    auto to_rela = [](const std::vector<Relocation> &relocations) {
+        std::vector<Elf64_Rela> relas;
+        relas.reserve(relocations.size());
+        for (const auto &relocation : relocations) {
+            relas.push_back({relocation.offset, ELF64_R_INFO(relocation.symbol, relocation.type), relocation.addend});
+        }
+        return relas;
+    };
+    const auto text_relas = to_rela(m_text_relocations);
+    const auto rodata_relas = to_rela(m_rodata_relocations);
+
+    StringTable shstrtab;
+    std::array<Elf64_Shdr, SectionIndex::Count> headers{};
+    auto add_header = [&](SectionIndex index, const char *name, std::uint32_t type, std::uint64_t flags,
+                          std::uint64_t alignment) -> Elf64_Shdr & {
+        auto &header = headers[index];
+        header.sh_name = shstrtab.add(name);
+        header.sh_type = type;
+        header.sh_flags = flags;
+        header.sh_addralign = alignment;
+        return header;
+    };
+    add_header(SectionIndex::Text, ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 16);
+    add_header(SectionIndex::Rodata, ".rodata", SHT_PROGBITS, SHF_ALLOC, 16);
+    auto &rela_text = add_header(SectionIndex::RelaText, ".rela.text", SHT_RELA, SHF_INFO_LINK, 8);
+    auto &rela_rodata = add_header(SectionIndex::RelaRodata, ".rela.rodata", SHT_RELA, SHF_INFO_LINK, 8);
+    auto &symtab = add_header(SectionIndex::Symtab, ".symtab", SHT_SYMTAB, 0, 8);
+    add_header(SectionIndex::Strtab, ".strtab", SHT_STRTAB, 0, 1);
+    add_header(SectionIndex::Shstrtab, ".shstrtab", SHT_STRTAB, 0, 1);
+    add_header(SectionIndex::NoteGnuStack, ".note.GNU-stack", SHT_PROGBITS, 0, 1);
+    for (auto *rela : {&rela_text, &rela_rodata}) {
+        rela->sh_link = SectionIndex::Symtab;
+        rela->sh_entsize = sizeof(Elf64_Rela);
+    }
+    rela_text.sh_info = SectionIndex::Text;
+    rela_rodata.sh_info = SectionIndex::Rodata;
+    symtab.sh_link = SectionIndex::Strtab;
+    symtab.sh_info = k_rodata_symbol + 1;
+    symtab.sh_entsize = sizeof(Elf64_Sym);
+
+    // Lay out the section contents after the ELF header, followed by the section header table.
+    std::vector<char> buffer(sizeof(Elf64_Ehdr));
+    auto emit_section = [&](SectionIndex index, const void *data, std::size_t size) {
+        auto &header = headers[index];
+        align(buffer, header.sh_addralign);
+        header.sh_offset = buffer.size();
+        header.sh_size = size;
+        const auto *bytes = static_cast<const char *>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    };
+    emit_section(SectionIndex::Text, m_text.data(), m_text.size());
+    emit_section(SectionIndex::Rodata, m_rodata.data(), m_rodata.size());
+    emit_section(SectionIndex::RelaText, text_relas.data(), text_relas.size() * sizeof(Elf64_Rela));
+    emit_section(SectionIndex::RelaRodata, rodata_relas.data(), rodata_relas.size() * sizeof(Elf64_Rela));
+    emit_section(SectionIndex::Symtab, symbols.data(), symbols.size() * sizeof(Elf64_Sym));
+    emit_section(SectionIndex::Strtab, strtab.data().data(), strtab.data().size());
+    emit_section(SectionIndex::Shstrtab, shstrtab.data().data(), shstrtab.data().size());
+    emit_section(SectionIndex::NoteGnuStack, nullptr, 0);
+    align(buffer, 8);
+    const auto section_headers_offset = buffer.size();
+    for (const auto &header : headers) {
+        append(buffer, header);
+    }
+
+    Elf64_Ehdr elf_header{};
+    std::memcpy(elf_header.e_ident, ELFMAG, SELFMAG);
+    elf_header.e_ident[EI_CLASS] = ELFCLASS64;
+    elf_header.e_ident[EI_DATA] = ELFDATA2LSB;
+    elf_header.e_ident[EI_VERSION] = EV_CURRENT;
+    elf_header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    elf_header.e_type = ET_REL;
+    elf_header.e_machine = EM_X86_64;
+    elf_header.e_version = EV_CURRENT;
+    elf_header.e_shoff = section_headers_offset;
+    elf_header.e_ehsize = sizeof(Elf64_Ehdr);
+    elf_header.e_shentsize = sizeof(Elf64_Shdr);
+    elf_header.e_shnum = SectionIndex::Count;
+    elf_header.e_shstrndx = SectionIndex::Shstrtab;
+    std::memcpy(buffer.data(), &elf_header, sizeof(Elf64_Ehdr));
+    return buffer;
+}
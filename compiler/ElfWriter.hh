@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ElfSection {
+    Text,
+    Rodata,
+};
+
+/// @brief Builds an x86-64 ELF relocatable object file.
+/// @details The object has a .text and a .rodata section, which the caller fills in directly, along with any number of
+/// global symbols and relocations against them.
+class ElfWriter {
+    struct Symbol {
+        std::string name;
+        bool defined;
+        ElfSection section;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    struct Relocation {
+        std::uint64_t offset;
+        std::uint32_t symbol;
+        std::uint32_t type;
+        std::int64_t addend;
+    };
+
+    std::vector<std::uint8_t> m_text;
+    std::vector<std::uint8_t> m_rodata;
+    std::vector<Symbol> m_symbols;
+    std::vector<Relocation> m_text_relocations;
+    std::vector<Relocation> m_rodata_relocations;
+
+public:
+    // Symbol indices of the section symbols, which can be used to refer to an offset in a section.
+    static constexpr std::uint32_t k_text_symbol = 1;
+    static constexpr std::uint32_t k_rodata_symbol = 2;
+
+    /// @brief Adds a global function symbol defined in .text.
+    /// @return The index of the symbol.
+    std::uint32_t add_function(std::string name, std::uint64_t offset, std::uint64_t size);
+
+    /// @brief Adds a global symbol which must be defined by another object.
+    /// @return The index of the symbol.
+    std::uint32_t add_undefined(std::string name);
+
+    void add_relocation(ElfSection section, std::uint64_t offset, std::uint32_t symbol, std::uint32_t type,
+                        std::int64_t addend);
+
+    /// @return The complete contents of the object file.
+    std::vector<char> write() const;
+
+    std::vector<std::uint8_t> &text() { return m_text; }
+    std::vector<std::uint8_t> &rodata() { return m_rodata; }
+};
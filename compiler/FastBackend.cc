@@ -0,0 +1,1002 @@
+#include <FastBackend.hh>
+
+#include <ElfWriter.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/DataLayout.hh>
+#include <ir/Function.hh>
+#include <ir/GlobalVariable.hh>
+#include <ir/Instructions.hh>
+#include <ir/Program.hh>
+#include <ir/Types.hh>
+#include <support/Assert.hh>
+#include <support/Error.hh>
+
+#include <elf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+enum class Reg : std::uint8_t {
+    Rax,
+    Rcx,
+    Rdx,
+    Rbx,
+    Rsp,
+    Rbp,
+    Rsi,
+    Rdi,
+    R8,
+    R9,
+    R10,
+    R11,
+};
+
+constexpr std::array k_arg_regs{Reg::Rdi, Reg::Rsi, Reg::Rdx, Reg::Rcx, Reg::R8, Reg::R9};
+
+// Registers which inline asm may use. Only caller saved registers are allowed, since no values are kept in registers
+// across instructions.
+const std::unordered_map<std::string, Reg> k_asm_regs{
+    {"rax", Reg::Rax}, {"rcx", Reg::Rcx}, {"rdx", Reg::Rdx}, {"rsi", Reg::Rsi}, {"rdi", Reg::Rdi},
+    {"r8", Reg::R8},   {"r9", Reg::R9},   {"r10", Reg::R10}, {"r11", Reg::R11},
+};
+
+// A memory operand of the form [base + disp].
+struct Mem {
+    Reg base;
+    std::int32_t disp;
+};
+
+enum class Cond : std::uint8_t {
+    Zero = 0x4,
+    Less = 0xc,
+    Greater = 0xf,
+};
+
+int low(Reg reg) {
+    return static_cast<int>(reg) & 7;
+}
+
+bool high(Reg reg) {
+    return static_cast<int>(reg) >= 8;
+}
+
+// Whether using `reg` as a byte register needs a REX prefix to avoid it being encoded as ah, ch, dh or bh.
+bool needs_byte_rex(Reg reg) {
+    return reg >= Reg::Rsp && reg <= Reg::Rdi;
+}
+
+class Assembler {
+    std::vector<std::uint8_t> &m_code;
+
+    void rex(bool w, Reg reg, Reg rm, bool force);
+    void modrm_mem(Reg reg, Mem mem);
+    void emit_mem(std::initializer_list<std::uint8_t> opcode, bool w, Reg reg, Mem mem, bool byte = false);
+    void emit_reg(std::initializer_list<std::uint8_t> opcode, bool w, Reg reg, Reg rm, bool byte = false);
+    std::size_t emit_rel32(std::initializer_list<std::uint8_t> opcode);
+
+public:
+    explicit Assembler(std::vector<std::uint8_t> &code) : m_code(code) {}
+
+    void emit8(std::uint8_t value) { m_code.push_back(value); }
+    void emit32(std::uint32_t value);
+    void emit64(std::uint64_t value);
+    void patch32(std::size_t position, std::uint32_t value);
+    std::size_t position() const { return m_code.size(); }
+
+    void add(Reg dst, Reg src) { emit_reg({0x01}, true, src, dst); }
+    void add(Reg dst, std::int32_t imm);
+    void cmp(Reg lhs, Reg rhs) { emit_reg({0x39}, true, rhs, lhs); }
+    void cqo() { emit8(0x48), emit8(0x99); }
+    void idiv(Reg src) { emit_reg({0xf7}, true, Reg::Rdi, src); }
+    void imul(Reg dst, Reg src) { emit_reg({0x0f, 0xaf}, true, dst, src); }
+    void imul(Reg dst, Reg src, std::int32_t imm);
+    void lea(Reg dst, Mem mem) { emit_mem({0x8d}, true, dst, mem); }
+    std::size_t lea_rip(Reg dst);
+    void load(Reg dst, Mem mem, std::size_t size);
+    void mov(Reg dst, Reg src) { emit_reg({0x89}, true, src, dst); }
+    void mov(Reg dst, std::uint64_t imm);
+    void push(Reg reg);
+    void set(Cond cond, Reg dst);
+    void sign_extend(Reg reg, std::int64_t bit_width);
+    void store(Mem mem, Reg src, std::size_t size);
+    void sub(Reg dst, Reg src) { emit_reg({0x29}, true, src, dst); }
+    std::size_t sub_rsp();
+    void test8(Reg reg) { emit_reg({0x84}, false, reg, reg, true); }
+    void zero_extend(Reg reg, std::int64_t bit_width);
+
+    std::size_t call() { return emit_rel32({0xe8}); }
+    void call(Reg callee) { emit_reg({0xff}, false, Reg::Rdx, callee); }
+    std::size_t jcc(Cond cond) { return emit_rel32({0x0f, static_cast<std::uint8_t>(0x80 | static_cast<int>(cond))}); }
+    std::size_t jmp() { return emit_rel32({0xe9}); }
+    void leave() { emit8(0xc9); }
+    void rep_movsb() { emit8(0xf3), emit8(0xa4); }
+    void ret() { emit8(0xc3); }
+    void syscall() { emit8(0x0f), emit8(0x05); }
+};
+
+void Assembler::rex(bool w, Reg reg, Reg rm, bool force) {
+    std::uint8_t prefix = 0x40 | (w ? 8 : 0) | (high(reg) ? 4 : 0) | (high(rm) ? 1 : 0);
+    if (prefix != 0x40 || force) {
+        emit8(prefix);
+    }
+}
+
+void Assembler::modrm_mem(Reg reg, Mem mem) {
+    const int base = low(mem.base);
+    const int mod = mem.disp == 0 && base != 5 ? 0 : mem.disp >= -128 && mem.disp <= 127 ? 1 : 2;
+    emit8(static_cast<std::uint8_t>(mod << 6 | low(reg) << 3 | base));
+    if (base == 4) {
+        // rsp and r12 as a base need a SIB byte.
+        emit8(0x24);
+    }
+    if (mod == 1) {
+        emit8(static_cast<std::uint8_t>(mem.disp));
+    } else if (mod == 2) {
+        emit32(static_cast<std::uint32_t>(mem.disp));
+    }
+}
+
+void Assembler::emit_mem(std::initializer_list<std::uint8_t> opcode, bool w, Reg reg, Mem mem, bool byte) {
+    rex(w, reg, mem.base, byte && needs_byte_rex(reg));
+    for (auto op : opcode) {
+        emit8(op);
+    }
+    modrm_mem(reg, mem);
+}
+
+void Assembler::emit_reg(std::initializer_list<std::uint8_t> opcode, bool w, Reg reg, Reg rm, bool byte) {
+    rex(w, reg, rm, byte && (needs_byte_rex(reg) || needs_byte_rex(rm)));
+    for (auto op : opcode) {
+        emit8(op);
+    }
+    emit8(static_cast<std::uint8_t>(0xc0 | low(reg) << 3 | low(rm)));
+}
+
+std::size_t Assembler::emit_rel32(std::initializer_list<std::uint8_t> opcode) {
+    for (auto op : opcode) {
+        emit8(op);
+    }
+    auto position = m_code.size();
+    emit32(0);
+    return position;
+}
+
+void Assembler::emit32(std::uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        emit8(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+}
+
+void Assembler::emit64(std::uint64_t value) {
+    emit32(static_cast<std::uint32_t>(value));
+    emit32(static_cast<std::uint32_t>(value >> 32));
+}
+
+void Assembler::patch32(std::size_t position, std::uint32_t value) {
+    std::memcpy(&m_code[position], &value, sizeof(value));
+}
+
+void Assembler::add(Reg dst, std::int32_t imm) {
+    emit_reg({0x81}, true, Reg::Rax, dst);
+    emit32(static_cast<std::uint32_t>(imm));
+}
+
+void Assembler::imul(Reg dst, Reg src, std::int32_t imm) {
+    emit_reg({0x69}, true, dst, src);
+    emit32(static_cast<std::uint32_t>(imm));
+}
+
+std::size_t Assembler::lea_rip(Reg dst) {
+    rex(true, dst, Reg::Rax, false);
+    emit8(0x8d);
+    emit8(static_cast<std::uint8_t>(low(dst) << 3 | 5));
+    auto position = m_code.size();
+    emit32(0);
+    return position;
+}
+
+void Assembler::load(Reg dst, Mem mem, std::size_t size) {
+    switch (size) {
+    case 1:
+        emit_mem({0x0f, 0xb6}, false, dst, mem);
+        break;
+    case 2:
+        emit_mem({0x0f, 0xb7}, false, dst, mem);
+        break;
+    case 4:
+        emit_mem({0x8b}, false, dst, mem);
+        break;
+    case 8:
+        emit_mem({0x8b}, true, dst, mem);
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+}
+
+void Assembler::mov(Reg dst, std::uint64_t imm) {
+    if (imm == 0) {
+        emit_reg({0x31}, false, dst, dst);
+    } else if (imm <= std::numeric_limits<std::uint32_t>::max()) {
+        rex(false, Reg::Rax, dst, false);
+        emit8(static_cast<std::uint8_t>(0xb8 + low(dst)));
+        emit32(static_cast<std::uint32_t>(imm));
+    } else if (static_cast<std::int64_t>(imm) >= std::numeric_limits<std::int32_t>::min()) {
+        emit_reg({0xc7}, true, Reg::Rax, dst);
+        emit32(static_cast<std::uint32_t>(imm));
+    } else {
+        rex(true, Reg::Rax, dst, false);
+        emit8(static_cast<std::uint8_t>(0xb8 + low(dst)));
+        emit64(imm);
+    }
+}
+
+void Assembler::push(Reg reg) {
+    rex(false, Reg::Rax, reg, false);
+    emit8(static_cast<std::uint8_t>(0x50 + low(reg)));
+}
+
+void Assembler::set(Cond cond, Reg dst) {
+    emit_reg({0x0f, static_cast<std::uint8_t>(0x90 | static_cast<int>(cond))}, false, Reg::Rax, dst, true);
+    emit_reg({0x0f, 0xb6}, false, dst, dst, true);
+}
+
+void Assembler::sign_extend(Reg reg, std::int64_t bit_width) {
+    switch (bit_width) {
+    case 1:
+        // and reg, 1; neg reg
+        emit_reg({0x83}, false, Reg::Rsp, reg);
+        emit8(1);
+        emit_reg({0xf7}, true, Reg::Rbx, reg);
+        break;
+    case 8:
+        emit_reg({0x0f, 0xbe}, true, reg, reg);
+        break;
+    case 16:
+        emit_reg({0x0f, 0xbf}, true, reg, reg);
+        break;
+    case 32:
+        emit_reg({0x63}, true, reg, reg);
+        break;
+    default:
+        break;
+    }
+}
+
+void Assembler::store(Mem mem, Reg src, std::size_t size) {
+    switch (size) {
+    case 1:
+        emit_mem({0x88}, false, src, mem, true);
+        break;
+    case 2:
+        emit8(0x66);
+        emit_mem({0x89}, false, src, mem);
+        break;
+    case 4:
+        emit_mem({0x89}, false, src, mem);
+        break;
+    case 8:
+        emit_mem({0x89}, true, src, mem);
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+}
+
+std::size_t Assembler::sub_rsp() {
+    emit_reg({0x81}, true, Reg::Rbp, Reg::Rsp);
+    auto position = m_code.size();
+    emit32(0);
+    return position;
+}
+
+void Assembler::zero_extend(Reg reg, std::int64_t bit_width) {
+    switch (bit_width) {
+    case 1:
+        emit_reg({0x83}, false, Reg::Rsp, reg);
+        emit8(1);
+        break;
+    case 8:
+        emit_reg({0x0f, 0xb6}, false, reg, reg, true);
+        break;
+    case 16:
+        emit_reg({0x0f, 0xb7}, false, reg, reg);
+        break;
+    case 32:
+        emit_reg({0x89}, false, reg, reg);
+        break;
+    default:
+        break;
+    }
+}
+
+std::size_t align_to(std::size_t value, std::size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+bool is_aggregate(const ir::Type *type) {
+    auto kind = ir::Type::base(type)->kind();
+    return kind == ir::TypeKind::Array || kind == ir::TypeKind::Struct;
+}
+
+// Global variables have the type of their initialiser, but are always used through their address.
+bool is_aggregate(const ir::Value *value) {
+    return value->kind() != ir::ValueKind::GlobalVariable && is_aggregate(value->type());
+}
+
+std::int64_t bit_width(const ir::Type *type) {
+    if (const auto *int_type = ir::Type::base_as<ir::IntType>(type)) {
+        return int_type->bit_width();
+    }
+    return ir::Type::base(type)->kind() == ir::TypeKind::Bool ? 1 : 64;
+}
+
+std::uint64_t truncate(std::uint64_t value, std::int64_t bit_width) {
+    return bit_width >= 64 ? value : value & ((std::uint64_t(1) << bit_width) - 1);
+}
+
+std::int64_t sign_extend(std::uint64_t value, std::int64_t bit_width) {
+    if (bit_width >= 64) {
+        return static_cast<std::int64_t>(value);
+    }
+    const auto shift = 64 - bit_width;
+    return static_cast<std::int64_t>(value << shift) >> shift;
+}
+
+const ir::Type *pointee_type(const ir::Type *type) {
+    return ir::Type::base_as<ir::PointerType>(type)->pointee_type();
+}
+
+class ObjectGen {
+    // A reference to a function whose address isn't known until all functions have been generated.
+    struct FunctionRef {
+        ElfSection section;
+        std::size_t position;
+        const ir::Function *function;
+        std::uint32_t type;
+    };
+
+    ElfWriter m_writer;
+    std::unordered_map<std::string, const ir::Function *> m_definitions;
+    std::unordered_map<const ir::Function *, std::pair<std::size_t, std::size_t>> m_function_ranges;
+    std::unordered_map<const ir::GlobalVariable *, std::size_t> m_global_offsets;
+    std::unordered_map<const ir::ConstantString *, std::size_t> m_string_offsets;
+    std::vector<FunctionRef> m_function_refs;
+
+    void write_constant(std::size_t offset, const ir::Value *value);
+
+public:
+    const ir::Function *canonical_function(const ir::Function *function) const;
+    std::size_t global_offset(const ir::GlobalVariable *global);
+    std::size_t string_offset(const ir::ConstantString *string);
+    void reference_function(ElfSection section, std::size_t position, const ir::Function *function,
+                            std::uint32_t type);
+    void reference_rodata(std::size_t position, std::size_t offset);
+    std::vector<char> gen_program(const ir::Program *program);
+
+    ElfWriter &writer() { return m_writer; }
+};
+
+class FunctionGen {
+    ObjectGen *const m_object;
+    const ir::Function *const m_function;
+    Assembler m_asm;
+    std::unordered_map<const ir::Value *, std::int32_t> m_slots;
+    std::unordered_map<const ir::BasicBlock *, std::size_t> m_block_positions;
+    std::vector<std::pair<std::size_t, const ir::BasicBlock *>> m_block_fixups;
+    std::size_t m_frame_size{0};
+    std::int32_t m_sret_slot{0};
+
+    std::int32_t allocate(std::size_t size, std::size_t align);
+    std::int32_t slot_of(const ir::Value *value) const { return m_slots.at(value); }
+    void copy(std::size_t size);
+    void load(Reg reg, const ir::Value *value);
+    void load_address(Reg reg, const ir::Value *value);
+    void load_arg(Reg reg, const ir::Value *value);
+    void move_to_slot(std::int32_t slot, const ir::Value *value);
+    void jump_to(const ir::BasicBlock *pred, const ir::BasicBlock *succ);
+
+    void gen_prologue(std::size_t &frame_size_position);
+    void gen_binary(const ir::BinaryInst *);
+    void gen_call(const ir::CallInst *);
+    void gen_cast(const ir::CastInst *);
+    void gen_compare(const ir::CompareInst *);
+    void gen_cond_branch(const ir::CondBranchInst *);
+    void gen_copy(const ir::CopyInst *);
+    void gen_inline_asm(const ir::InlineAsmInst *);
+    void gen_lea(const ir::LeaInst *);
+    void gen_load(const ir::LoadInst *);
+    void gen_store(const ir::StoreInst *);
+    void gen_ret(const ir::RetInst *);
+    void gen_instruction(const ir::Instruction *);
+
+public:
+    FunctionGen(ObjectGen *object, const ir::Function *function)
+        : m_object(object), m_function(function), m_asm(object->writer().text()) {}
+
+    void gen();
+};
+
+std::int32_t FunctionGen::allocate(std::size_t size, std::size_t align) {
+    m_frame_size = align_to(m_frame_size + size, align);
+    return -static_cast<std::int32_t>(m_frame_size);
+}
+
+// Copies `size` bytes from rsi to rdi.
+void FunctionGen::copy(std::size_t size) {
+    m_asm.mov(Reg::Rcx, size);
+    m_asm.rep_movsb();
+}
+
+void FunctionGen::load(Reg reg, const ir::Value *value) {
+    switch (value->kind()) {
+    case ir::ValueKind::Argument:
+    case ir::ValueKind::Instruction:
+        m_asm.load(reg, {Reg::Rbp, slot_of(value)}, 8);
+        return;
+    case ir::ValueKind::LocalVar:
+        m_asm.lea(reg, {Reg::Rbp, slot_of(value)});
+        return;
+    case ir::ValueKind::Function: {
+        auto position = m_asm.lea_rip(reg);
+        m_object->reference_function(ElfSection::Text, position, value->as<ir::Function>(), R_X86_64_PC32);
+        return;
+    }
+    case ir::ValueKind::GlobalVariable: {
+        auto offset = m_object->global_offset(value->as<ir::GlobalVariable>());
+        m_object->reference_rodata(m_asm.lea_rip(reg), offset);
+        return;
+    }
+    case ir::ValueKind::Constant:
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+
+    const auto *constant = value->as<ir::Constant>();
+    switch (constant->kind()) {
+    case ir::ConstantKind::Int:
+        m_asm.mov(reg, truncate(constant->as<ir::ConstantInt>()->value(), bit_width(constant->type())));
+        break;
+    case ir::ConstantKind::String: {
+        auto offset = m_object->string_offset(constant->as<ir::ConstantString>());
+        m_object->reference_rodata(m_asm.lea_rip(reg), offset);
+        break;
+    }
+    default:
+        m_asm.mov(reg, std::uint64_t(0));
+        break;
+    }
+}
+
+// Loads the address of an aggregate value into `reg`.
+void FunctionGen::load_address(Reg reg, const ir::Value *value) {
+    if (!m_slots.contains(value)) {
+        // Only undef aggregate constants don't already have a slot, so their contents don't matter.
+        ENSURE(value->kind() == ir::ValueKind::Constant);
+        m_slots.emplace(value, allocate(ir::size_of(value->type()), 8));
+    }
+    m_asm.lea(reg, {Reg::Rbp, slot_of(value)});
+}
+
+void FunctionGen::load_arg(Reg reg, const ir::Value *value) {
+    if (is_aggregate(value)) {
+        load_address(reg, value);
+        return;
+    }
+
+    // Values narrower than 32 bits are extended by the caller, as expected by C compilers.
+    load(reg, value);
+    const auto *int_type = ir::Type::base_as<ir::IntType>(value->type());
+    auto width = bit_width(value->type());
+    if (width < 32 && int_type != nullptr && int_type->is_signed()) {
+        m_asm.sign_extend(reg, width);
+        m_asm.zero_extend(reg, 32);
+    } else if (width < 32) {
+        m_asm.zero_extend(reg, width);
+    }
+}
+
+void FunctionGen::move_to_slot(std::int32_t slot, const ir::Value *value) {
+    if (is_aggregate(value)) {
+        load_address(Reg::Rsi, value);
+        m_asm.lea(Reg::Rdi, {Reg::Rbp, slot});
+        copy(ir::size_of(value->type()));
+        return;
+    }
+    load(Reg::Rax, value);
+    m_asm.store({Reg::Rbp, slot}, Reg::Rax, 8);
+}
+
+// Sets up the phis in `succ` for the edge from `pred` and jumps to `succ`. Since the CFG is acyclic, a phi can never be
+// an incoming value of a phi in the same block, so the moves can be performed in order.
+void FunctionGen::jump_to(const ir::BasicBlock *pred, const ir::BasicBlock *succ) {
+    for (const auto *inst : *succ) {
+        const auto *phi = inst->as_or_null<ir::PhiInst>();
+        if (phi == nullptr) {
+            break;
+        }
+        auto it = phi->incoming().find(const_cast<ir::BasicBlock *>(pred));
+        if (it != phi->incoming().end()) {
+            move_to_slot(slot_of(phi), it->second);
+        }
+    }
+    m_block_fixups.emplace_back(m_asm.jmp(), succ);
+}
+
+void FunctionGen::gen_prologue(std::size_t &frame_size_position) {
+    m_asm.push(Reg::Rbp);
+    m_asm.mov(Reg::Rbp, Reg::Rsp);
+    frame_size_position = m_asm.sub_rsp();
+
+    // Aggregates are passed by pointer and returned through a hidden pointer in the first argument register.
+    std::size_t reg_index = 0;
+    if (is_aggregate(m_function->return_type())) {
+        m_sret_slot = allocate(8, 8);
+        m_asm.store({Reg::Rbp, m_sret_slot}, k_arg_regs[reg_index++], 8);
+    }
+    std::vector<std::pair<std::int32_t, const ir::Argument *>> aggregate_args;
+    std::int32_t stack_offset = 16;
+    for (const auto *arg : m_function->args()) {
+        std::int32_t slot = 0;
+        if (reg_index < k_arg_regs.size()) {
+            slot = allocate(8, 8);
+            m_asm.store({Reg::Rbp, slot}, k_arg_regs[reg_index++], 8);
+        } else {
+            slot = stack_offset;
+            stack_offset += 8;
+        }
+        if (is_aggregate(arg->type())) {
+            aggregate_args.emplace_back(slot, arg);
+            continue;
+        }
+        m_slots.emplace(arg, slot);
+    }
+
+    // Copy aggregate arguments into the frame once all the argument registers have been saved.
+    for (auto [pointer_slot, arg] : aggregate_args) {
+        auto size = ir::size_of(arg->type());
+        auto slot = allocate(size, 8);
+        m_asm.load(Reg::Rsi, {Reg::Rbp, pointer_slot}, 8);
+        m_asm.lea(Reg::Rdi, {Reg::Rbp, slot});
+        copy(size);
+        m_slots.emplace(arg, slot);
+    }
+    for (const auto *var : m_function->vars()) {
+        auto align = std::max<std::size_t>(ir::align_of(var->var_type()), 8);
+        m_slots.emplace(var, allocate(ir::size_of(var->var_type()), align));
+    }
+    for (const auto *block : *m_function) {
+        for (const auto *inst : *block) {
+            if (inst->type() != nullptr && ir::Type::base(inst->type())->kind() != ir::TypeKind::Void) {
+                m_slots.emplace(inst, allocate(std::max<std::size_t>(ir::size_of(inst->type()), 8), 8));
+            }
+        }
+    }
+}
+
+void FunctionGen::gen_binary(const ir::BinaryInst *binary) {
+    load(Reg::Rax, binary->lhs());
+    load(Reg::Rcx, binary->rhs());
+    switch (binary->op()) {
+    case ir::BinaryOp::Add:
+        m_asm.add(Reg::Rax, Reg::Rcx);
+        break;
+    case ir::BinaryOp::Sub:
+        m_asm.sub(Reg::Rax, Reg::Rcx);
+        break;
+    case ir::BinaryOp::Mul:
+        m_asm.imul(Reg::Rax, Reg::Rcx);
+        break;
+    case ir::BinaryOp::Div:
+        m_asm.sign_extend(Reg::Rax, bit_width(binary->type()));
+        m_asm.sign_extend(Reg::Rcx, bit_width(binary->type()));
+        m_asm.cqo();
+        m_asm.idiv(Reg::Rcx);
+        break;
+    }
+    m_asm.store({Reg::Rbp, slot_of(binary)}, Reg::Rax, 8);
+}
+
+void FunctionGen::gen_call(const ir::CallInst *call) {
+    const bool sret = is_aggregate(call->callee_function_type()->return_type());
+    std::size_t reg_index = sret ? 1 : 0;
+    std::vector<std::pair<Reg, const ir::Value *>> reg_args;
+    std::vector<const ir::Value *> stack_args;
+    for (const auto *arg : call->args()) {
+        if (reg_index < k_arg_regs.size()) {
+            reg_args.emplace_back(k_arg_regs[reg_index++], arg);
+        } else {
+            stack_args.push_back(arg);
+        }
+    }
+
+    // Keep the stack 16 byte aligned at the call.
+    std::int32_t stack_size = static_cast<std::int32_t>(align_to(stack_args.size(), 2) * 8);
+    if (stack_args.size() % 2 != 0) {
+        m_asm.add(Reg::Rsp, -8);
+    }
+    for (auto it = stack_args.rbegin(); it != stack_args.rend(); ++it) {
+        load_arg(Reg::Rax, *it);
+        m_asm.push(Reg::Rax);
+    }
+    for (auto [reg, arg] : reg_args) {
+        load_arg(reg, arg);
+    }
+    if (sret) {
+        m_asm.lea(k_arg_regs[0], {Reg::Rbp, slot_of(call)});
+    }
+
+    if (const auto *callee = call->callee()->as_or_null<ir::Function>()) {
+        m_object->reference_function(ElfSection::Text, m_asm.call(), callee, R_X86_64_PLT32);
+    } else {
+        load(Reg::R11, call->callee());
+        m_asm.call(Reg::R11);
+    }
+    if (stack_size != 0) {
+        m_asm.add(Reg::Rsp, stack_size);
+    }
+    if (!sret && m_slots.contains(call)) {
+        m_asm.store({Reg::Rbp, slot_of(call)}, Reg::Rax, 8);
+    }
+}
+
+void FunctionGen::gen_cast(const ir::CastInst *cast) {
+    switch (cast->op()) {
+    case ir::CastOp::SignExtend:
+        load(Reg::Rax, cast->val());
+        m_asm.sign_extend(Reg::Rax, bit_width(cast->val()->type()));
+        m_asm.store({Reg::Rbp, slot_of(cast)}, Reg::Rax, 8);
+        break;
+    case ir::CastOp::ZeroExtend:
+        load(Reg::Rax, cast->val());
+        m_asm.zero_extend(Reg::Rax, bit_width(cast->val()->type()));
+        m_asm.store({Reg::Rbp, slot_of(cast)}, Reg::Rax, 8);
+        break;
+    default:
+        // Only the low bits of a value are ever used, so truncation and reinterpretation are plain moves.
+        move_to_slot(slot_of(cast), cast->val());
+        break;
+    }
+}
+
+void FunctionGen::gen_compare(const ir::CompareInst *compare) {
+    auto width = bit_width(compare->lhs()->type());
+    load(Reg::Rax, compare->lhs());
+    load(Reg::Rcx, compare->rhs());
+    m_asm.sign_extend(Reg::Rax, width);
+    m_asm.sign_extend(Reg::Rcx, width);
+    m_asm.cmp(Reg::Rax, Reg::Rcx);
+    m_asm.set(compare->op() == ir::CompareOp::LessThan ? Cond::Less : Cond::Greater, Reg::Rax);
+    m_asm.store({Reg::Rbp, slot_of(compare)}, Reg::Rax, 8);
+}
+
+void FunctionGen::gen_cond_branch(const ir::CondBranchInst *cond_branch) {
+    load(Reg::Rax, cond_branch->cond());
+    m_asm.test8(Reg::Rax);
+    auto false_position = m_asm.jcc(Cond::Zero);
+    jump_to(cond_branch->parent(), cond_branch->true_dst());
+    m_asm.patch32(false_position, static_cast<std::uint32_t>(m_asm.position() - (false_position + 4)));
+    jump_to(cond_branch->parent(), cond_branch->false_dst());
+}
+
+void FunctionGen::gen_copy(const ir::CopyInst *copy) {
+    load(Reg::Rdi, copy->dst());
+    load(Reg::Rsi, copy->src());
+    load(Reg::Rcx, copy->len());
+    m_asm.rep_movsb();
+}
+
+void FunctionGen::gen_inline_asm(const ir::InlineAsmInst *inline_asm) {
+    if (inline_asm->instruction() != "syscall") {
+        print_error_and_abort("fast backend cannot assemble inline asm '{}'", inline_asm->instruction());
+    }
+    auto reg_of = [](const std::string &name) {
+        auto it = k_asm_regs.find(name);
+        if (it == k_asm_regs.end()) {
+            print_error_and_abort("fast backend cannot use register '{}' in inline asm", name);
+        }
+        return it->second;
+    };
+    for (const auto &[name, value] : inline_asm->inputs()) {
+        load(reg_of(name), value);
+    }
+    m_asm.syscall();
+    for (const auto &[name, value] : inline_asm->outputs()) {
+        const auto *var = value->as<ir::LocalVar>();
+        m_asm.store({Reg::Rbp, slot_of(var)}, reg_of(name), ir::size_of(var->var_type()));
+    }
+}
+
+void FunctionGen::gen_lea(const ir::LeaInst *lea) {
+    load(Reg::Rax, lea->ptr());
+    std::int64_t offset = 0;
+    auto add_index = [&](const ir::Value *index, std::size_t scale) {
+        const auto *constant = index->as_or_null<ir::Constant>();
+        const auto *constant_int = constant != nullptr ? constant->as_or_null<ir::ConstantInt>() : nullptr;
+        if (constant_int != nullptr) {
+            offset += sign_extend(constant_int->value(), bit_width(index->type())) * static_cast<std::int64_t>(scale);
+            return;
+        }
+        load(Reg::Rcx, index);
+        m_asm.sign_extend(Reg::Rcx, bit_width(index->type()));
+        m_asm.imul(Reg::Rcx, Reg::Rcx, static_cast<std::int32_t>(scale));
+        m_asm.add(Reg::Rax, Reg::Rcx);
+    };
+
+    // A lea with a single index offsets the pointer by its own pointee type, as with LLVM's GEP.
+    const auto &indices = lea->indices();
+    if (indices.size() == 1) {
+        add_index(indices[0], ir::size_of(pointee_type(lea->type())));
+    } else {
+        const auto *type = pointee_type(lea->ptr()->type());
+        add_index(indices[0], ir::size_of(type));
+        for (std::size_t i = 1; i < indices.size(); i++) {
+            type = ir::Type::base(type);
+            if (const auto *struct_type = type->as_or_null<ir::StructType>()) {
+                const auto *index = indices[i]->as<ir::Constant>()->as<ir::ConstantInt>();
+                offset += static_cast<std::int64_t>(ir::field_offset(struct_type, index->value()));
+                type = struct_type->fields()[index->value()].type();
+                continue;
+            }
+            type = type->as<ir::ArrayType>()->element_type();
+            add_index(indices[i], ir::size_of(type));
+        }
+    }
+    if (offset != 0) {
+        ENSURE(offset >= std::numeric_limits<std::int32_t>::min() &&
+               offset <= std::numeric_limits<std::int32_t>::max());
+        m_asm.add(Reg::Rax, static_cast<std::int32_t>(offset));
+    }
+    m_asm.store({Reg::Rbp, slot_of(lea)}, Reg::Rax, 8);
+}
+
+void FunctionGen::gen_load(const ir::LoadInst *load_inst) {
+    load(Reg::Rsi, load_inst->ptr());
+    if (is_aggregate(load_inst->type())) {
+        m_asm.lea(Reg::Rdi, {Reg::Rbp, slot_of(load_inst)});
+        copy(ir::size_of(load_inst->type()));
+        return;
+    }
+    m_asm.load(Reg::Rax, {Reg::Rsi, 0}, ir::size_of(load_inst->type()));
+    m_asm.store({Reg::Rbp, slot_of(load_inst)}, Reg::Rax, 8);
+}
+
+void FunctionGen::gen_store(const ir::StoreInst *store) {
+    if (is_aggregate(store->val())) {
+        load(Reg::Rdi, store->ptr());
+        load_address(Reg::Rsi, store->val());
+        copy(ir::size_of(store->val()->type()));
+        return;
+    }
+    load(Reg::Rax, store->val());
+    load(Reg::Rcx, store->ptr());
+    m_asm.store({Reg::Rcx, 0}, Reg::Rax, ir::size_of(store->val()->type()));
+}
+
+void FunctionGen::gen_ret(const ir::RetInst *ret) {
+    if (ret->val() != nullptr && is_aggregate(ret->val())) {
+        m_asm.load(Reg::Rdi, {Reg::Rbp, m_sret_slot}, 8);
+        load_address(Reg::Rsi, ret->val());
+        copy(ir::size_of(ret->val()->type()));
+        m_asm.load(Reg::Rax, {Reg::Rbp, m_sret_slot}, 8);
+    } else if (ret->val() != nullptr) {
+        load(Reg::Rax, ret->val());
+    }
+    m_asm.leave();
+    m_asm.ret();
+}
+
+void FunctionGen::gen_instruction(const ir::Instruction *instruction) {
+    switch (instruction->kind()) {
+    case ir::InstKind::Binary:
+        gen_binary(instruction->as<ir::BinaryInst>());
+        break;
+    case ir::InstKind::Branch: {
+        const auto *branch = instruction->as<ir::BranchInst>();
+        jump_to(branch->parent(), branch->dst());
+        break;
+    }
+    case ir::InstKind::Call:
+        gen_call(instruction->as<ir::CallInst>());
+        break;
+    case ir::InstKind::Cast:
+        gen_cast(instruction->as<ir::CastInst>());
+        break;
+    case ir::InstKind::Compare:
+        gen_compare(instruction->as<ir::CompareInst>());
+        break;
+    case ir::InstKind::CondBranch:
+        gen_cond_branch(instruction->as<ir::CondBranchInst>());
+        break;
+    case ir::InstKind::Copy:
+        gen_copy(instruction->as<ir::CopyInst>());
+        break;
+    case ir::InstKind::InlineAsm:
+        gen_inline_asm(instruction->as<ir::InlineAsmInst>());
+        break;
+    case ir::InstKind::Lea:
+        gen_lea(instruction->as<ir::LeaInst>());
+        break;
+    case ir::InstKind::Load:
+        gen_load(instruction->as<ir::LoadInst>());
+        break;
+    case ir::InstKind::Phi:
+        // Phis are set up by the predecessors.
+        break;
+    case ir::InstKind::Store:
+        gen_store(instruction->as<ir::StoreInst>());
+        break;
+    case ir::InstKind::Ret:
+        gen_ret(instruction->as<ir::RetInst>());
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+}
+
+void FunctionGen::gen() {
+    std::size_t frame_size_position = 0;
+    gen_prologue(frame_size_position);
+    for (auto it = m_function->begin(); it != m_function->end(); ++it) {
+        const auto *block = *it;
+        m_block_positions.emplace(block, m_asm.position());
+        for (const auto *inst : *block) {
+            gen_instruction(inst);
+        }
+
+        // Blocks without a terminator fall through to the next block.
+        const auto *last = !block->empty() ? block->terminator() : nullptr;
+        if (last != nullptr && (last->kind() == ir::InstKind::Branch || last->kind() == ir::InstKind::CondBranch ||
+                                last->kind() == ir::InstKind::Ret)) {
+            continue;
+        }
+        auto next = it;
+        if (++next != m_function->end()) {
+            jump_to(block, *next);
+            continue;
+        }
+        m_asm.leave();
+        m_asm.ret();
+    }
+
+    for (auto [position, block] : m_block_fixups) {
+        m_asm.patch32(position, static_cast<std::uint32_t>(m_block_positions.at(block) - (position + 4)));
+    }
+    m_asm.patch32(frame_size_position, static_cast<std::uint32_t>(align_to(m_frame_size, 16)));
+}
+
+const ir::Function *ObjectGen::canonical_function(const ir::Function *function) const {
+    // Extern declarations of functions defined elsewhere in the program (such as `main`) refer to the definition.
+    if (function->prototype()->externed()) {
+        if (auto it = m_definitions.find(function->name()); it != m_definitions.end()) {
+            return it->second;
+        }
+    }
+    return function;
+}
+
+void ObjectGen::write_constant(std::size_t offset, const ir::Value *value) {
+    if (const auto *function = value->as_or_null<ir::Function>()) {
+        reference_function(ElfSection::Rodata, offset, function, R_X86_64_64);
+        return;
+    }
+    if (const auto *global = value->as_or_null<ir::GlobalVariable>()) {
+        m_writer.add_relocation(ElfSection::Rodata, offset, ElfWriter::k_rodata_symbol, R_X86_64_64,
+                                static_cast<std::int64_t>(global_offset(global)));
+        return;
+    }
+
+    const auto *constant = value->as<ir::Constant>();
+    switch (constant->kind()) {
+    case ir::ConstantKind::Array: {
+        const auto *constant_array = constant->as<ir::ConstantArray>();
+        const auto *element_type = constant_array->type()->as<ir::ArrayType>()->element_type();
+        for (std::size_t i = 0; const auto *elem : constant_array->elems()) {
+            write_constant(offset + i++ * ir::size_of(element_type), elem);
+        }
+        break;
+    }
+    case ir::ConstantKind::Int: {
+        auto int_value = constant->as<ir::ConstantInt>()->value();
+        std::memcpy(&m_writer.rodata()[offset], &int_value, ir::size_of(constant->type()));
+        break;
+    }
+    case ir::ConstantKind::String:
+        m_writer.add_relocation(ElfSection::Rodata, offset, ElfWriter::k_rodata_symbol, R_X86_64_64,
+                                static_cast<std::int64_t>(string_offset(constant->as<ir::ConstantString>())));
+        break;
+    default:
+        // Null and undef are both zero, which the rodata already is.
+        break;
+    }
+}
+
+std::size_t ObjectGen::global_offset(const ir::GlobalVariable *global) {
+    if (auto it = m_global_offsets.find(global); it != m_global_offsets.end()) {
+        return it->second;
+    }
+    const auto *type = global->initialiser()->type();
+    auto offset = align_to(m_writer.rodata().size(), ir::align_of(type));
+    m_writer.rodata().resize(offset + ir::size_of(type));
+    m_global_offsets.emplace(global, offset);
+    write_constant(offset, global->initialiser());
+    return offset;
+}
+
+std::size_t ObjectGen::string_offset(const ir::ConstantString *string) {
+    if (auto it = m_string_offsets.find(string); it != m_string_offsets.end()) {
+        return it->second;
+    }
+    auto &rodata = m_writer.rodata();
+    auto offset = rodata.size();
+    rodata.insert(rodata.end(), string->value().begin(), string->value().end());
+    rodata.push_back('\0');
+    m_string_offsets.emplace(string, offset);
+    return offset;
+}
+
+void ObjectGen::reference_function(ElfSection section, std::size_t position, const ir::Function *function,
+                                   std::uint32_t type) {
+    m_function_refs.push_back({section, position, canonical_function(function), type});
+}
+
+void ObjectGen::reference_rodata(std::size_t position, std::size_t offset) {
+    m_writer.add_relocation(ElfSection::Text, position, ElfWriter::k_rodata_symbol, R_X86_64_PC32,
+                            static_cast<std::int64_t>(offset) - 4);
+}
+
+std::vector<char> ObjectGen::gen_program(const ir::Program *program) {
+    for (const auto *function : *program) {
+        if (!function->prototype()->externed()) {
+            m_definitions.emplace(function->name(), function);
+        }
+    }
+
+    auto &text = m_writer.text();
+    std::unordered_map<const ir::Function *, std::uint32_t> symbols;
+    for (const auto *function : *program) {
+        if (function->prototype()->externed()) {
+            continue;
+        }
+        text.resize(align_to(text.size(), 16), 0xcc);
+        auto begin = text.size();
+        FunctionGen(this, function).gen();
+        m_function_ranges.emplace(function, std::make_pair(begin, text.size()));
+        symbols.emplace(function, m_writer.add_function(function->name(), begin, text.size() - begin));
+    }
+
+    // Calls and address computations within .text can be resolved directly, everything else needs a relocation.
+    for (const auto &ref : m_function_refs) {
+        auto it = m_function_ranges.find(ref.function);
+        if (ref.section == ElfSection::Text && it != m_function_ranges.end()) {
+            auto displacement = it->second.first - (ref.position + 4);
+            std::memcpy(&text[ref.position], &displacement, 4);
+            continue;
+        }
+        if (!symbols.contains(ref.function)) {
+            symbols.emplace(ref.function, m_writer.add_undefined(ref.function->name()));
+        }
+        m_writer.add_relocation(ref.section, ref.position, symbols.at(ref.function), ref.type,
+                                ref.section == ElfSection::Text ? -4 : 0);
+    }
+    return m_writer.write();
+}
+
+} // namespace
+
+std::vector<char> gen_fast_object(const ir::Program *program) {
+    ObjectGen gen;
+    return gen.gen_program(program);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+
+namespace ir {
+
+class Program;
+
+} // namespace ir
+
+/// @brief Generates an x86-64 ELF object file for `program` directly from the IR, without going through LLVM.
+/// @details Every value lives in its own stack slot and each instruction is lowered with a fixed template, trading code
+/// quality for codegen speed.
+/// @return The contents of the object file.
+std::vector<char> gen_fast_object(const ir::Program *program);
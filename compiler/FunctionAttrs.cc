@@ -0,0 +1,320 @@
+#include <FunctionAttrs.hh>
+
+#include <ir/BasicBlock.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <ir/Program.hh>
+#include <ir/Types.hh>
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+template <typename T>
+const T *as_inst(const ir::Value *value) {
+    const auto *inst = value->as_or_null<ir::Instruction>();
+    return inst != nullptr ? inst->as_or_null<T>() : nullptr;
+}
+
+// Strips address computations and reinterpreting casts off a pointer, returning the value it is based on.
+const ir::Value *pointer_root(const ir::Value *ptr) {
+    while (true) {
+        if (const auto *lea = as_inst<ir::LeaInst>(ptr)) {
+            ptr = lea->ptr();
+            continue;
+        }
+        const auto *cast = as_inst<ir::CastInst>(ptr);
+        if (cast == nullptr || cast->op() != ir::CastOp::Reinterpret) {
+            return ptr;
+        }
+        ptr = cast->val();
+    }
+}
+
+class Inferrer {
+    std::unordered_map<std::string, const ir::Function *> m_definitions;
+    std::unordered_map<std::string, std::vector<const ir::Function *>> m_declarations;
+    std::unordered_map<const ir::Function *, FunctionAttrs> m_attrs;
+    std::unordered_set<const ir::Function *> m_in_progress;
+
+    const ir::Function *definition(const ir::Function *function) const;
+    const FunctionAttrs *attrs_of(const ir::Function *function);
+    bool is_readonly_param(const ir::Function *callee, std::size_t index);
+    bool is_written_through(const ir::Value *ptr);
+    bool is_only_passed_to(const ir::LocalVar *var, const ir::CallInst *call, std::size_t index);
+    void infer(const ir::Function *function);
+    void infer_noalias(const ir::Function *function);
+
+public:
+    explicit Inferrer(const ir::Program *program);
+
+    std::unordered_map<const ir::Function *, FunctionAttrs> run();
+};
+
+Inferrer::Inferrer(const ir::Program *program) {
+    for (const auto *function : *program) {
+        if (function->prototype()->externed()) {
+            m_declarations[function->name()].push_back(function);
+        } else {
+            m_definitions.emplace(function->name(), function);
+        }
+    }
+}
+
+const ir::Function *Inferrer::definition(const ir::Function *function) const {
+    if (!function->prototype()->externed()) {
+        return function;
+    }
+    auto it = m_definitions.find(function->name());
+    return it != m_definitions.end() ? it->second : nullptr;
+}
+
+// Returns the attributes of `function`, or null if nothing is known about it, either because it isn't defined in the
+// program or because it is (mutually) recursive.
+const FunctionAttrs *Inferrer::attrs_of(const ir::Function *function) {
+    const auto *defined = definition(function);
+    if (defined == nullptr || m_in_progress.contains(defined)) {
+        return nullptr;
+    }
+    if (!m_attrs.contains(defined)) {
+        infer(defined);
+    }
+    return &m_attrs.at(defined);
+}
+
+bool Inferrer::is_readonly_param(const ir::Function *callee, std::size_t index) {
+    // Pointer mutability can't be relied on for external functions, since field pointers are always mutable.
+    const auto *attrs = attrs_of(callee);
+    return attrs != nullptr && attrs->readonly_args[index];
+}
+
+// Returns true if anything is written through `ptr` or a pointer derived from it, or if it escapes in a way that might
+// allow that.
+bool Inferrer::is_written_through(const ir::Value *ptr) {
+    std::vector<const ir::Value *> work_list{ptr};
+    std::unordered_set<const ir::Value *> visited{ptr};
+    auto push = [&](const ir::Value *value) {
+        if (visited.insert(value).second) {
+            work_list.push_back(value);
+        }
+    };
+    while (!work_list.empty()) {
+        const auto *value = work_list.back();
+        work_list.pop_back();
+        for (const auto *user : value->users()) {
+            const auto *inst = user->as_or_null<ir::Instruction>();
+            if (inst == nullptr) {
+                return true;
+            }
+            switch (inst->kind()) {
+            case ir::InstKind::Compare:
+            case ir::InstKind::Load:
+                continue;
+            case ir::InstKind::Lea:
+            case ir::InstKind::Phi:
+                push(inst);
+                continue;
+            case ir::InstKind::Ret:
+                // The caller may write through the returned pointer.
+                return true;
+            case ir::InstKind::Cast:
+                if (inst->as<ir::CastInst>()->op() != ir::CastOp::Reinterpret) {
+                    return true;
+                }
+                push(inst);
+                continue;
+            case ir::InstKind::Call: {
+                const auto *call = inst->as<ir::CallInst>();
+                const auto *callee = call->callee()->as_or_null<ir::Function>();
+                if (callee == nullptr || call->callee() == value) {
+                    return true;
+                }
+                for (std::size_t i = 0; i < call->args().size(); i++) {
+                    if (call->args()[i] == value && !is_readonly_param(callee, i)) {
+                        return true;
+                    }
+                }
+                continue;
+            }
+            default:
+                // Stores, copies and inline asm either write through the pointer or let it escape.
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Returns true if the only way `var` escapes its function is by being passed to `call` as argument `index`.
+bool Inferrer::is_only_passed_to(const ir::LocalVar *var, const ir::CallInst *call, std::size_t index) {
+    std::vector<const ir::Value *> work_list{var};
+    std::size_t passed_count = 0;
+    while (!work_list.empty()) {
+        const auto *value = work_list.back();
+        work_list.pop_back();
+        for (const auto *user : value->users()) {
+            const auto *inst = user->as_or_null<ir::Instruction>();
+            if (inst == nullptr) {
+                return false;
+            }
+            if (const auto *store = inst->as_or_null<ir::StoreInst>(); store != nullptr && store->val() != value) {
+                continue;
+            }
+            if (const auto *cast = inst->as_or_null<ir::CastInst>()) {
+                if (cast->op() != ir::CastOp::Reinterpret) {
+                    return false;
+                }
+                work_list.push_back(cast);
+                continue;
+            }
+            switch (inst->kind()) {
+            case ir::InstKind::Compare:
+            case ir::InstKind::Load:
+                continue;
+            case ir::InstKind::InlineAsm: {
+                const auto &inputs = inst->as<ir::InlineAsmInst>()->inputs();
+                if (std::any_of(inputs.begin(), inputs.end(), [&](const auto &input) {
+                        return input.second == value;
+                    })) {
+                    return false;
+                }
+                continue;
+            }
+            case ir::InstKind::Lea:
+                work_list.push_back(inst);
+                continue;
+            case ir::InstKind::Call:
+                if (inst != call || call->args()[index] != value ||
+                    std::count(call->args().begin(), call->args().end(), value) != 1) {
+                    return false;
+                }
+                passed_count++;
+                continue;
+            default:
+                return false;
+            }
+        }
+    }
+    return passed_count == 1;
+}
+
+void Inferrer::infer(const ir::Function *function) {
+    m_in_progress.insert(function);
+    FunctionAttrs attrs;
+    attrs.memory = MemoryEffect::None;
+    attrs.will_return = true;
+    auto add_effect = [&](MemoryEffect effect) {
+        attrs.memory = std::max(attrs.memory, effect);
+    };
+    for (const auto *block : *function) {
+        for (const auto *inst : *block) {
+            switch (inst->kind()) {
+            case ir::InstKind::Load:
+                if (!pointer_root(inst->as<ir::LoadInst>()->ptr())->is<ir::LocalVar>()) {
+                    add_effect(MemoryEffect::ReadOnly);
+                }
+                break;
+            case ir::InstKind::Store:
+                if (!pointer_root(inst->as<ir::StoreInst>()->ptr())->is<ir::LocalVar>()) {
+                    add_effect(MemoryEffect::Any);
+                }
+                break;
+            case ir::InstKind::Copy:
+                add_effect(MemoryEffect::Any);
+                break;
+            case ir::InstKind::InlineAsm:
+                // Inline asm is used for syscalls, which can do anything, including not returning.
+                add_effect(MemoryEffect::Any);
+                attrs.will_return = false;
+                break;
+            case ir::InstKind::Call: {
+                // Without loops, a function can only fail to return through its callees.
+                const auto *callee = inst->as<ir::CallInst>()->callee()->as_or_null<ir::Function>();
+                const auto *callee_attrs = callee != nullptr ? attrs_of(callee) : nullptr;
+                if (callee_attrs == nullptr) {
+                    add_effect(MemoryEffect::Any);
+                    attrs.will_return = false;
+                    break;
+                }
+                add_effect(callee_attrs->memory);
+                attrs.will_return &= callee_attrs->will_return;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    // Insert before inferring argument attributes so that recursive calls see the function's own attributes. Until
+    // then, no argument is assumed to be read only.
+    m_in_progress.erase(function);
+    attrs.readonly_args.resize(function->function_type()->params().size());
+    attrs.noalias_args.resize(attrs.readonly_args.size());
+    m_attrs.emplace(function, std::move(attrs));
+    for (std::size_t i = 0; const auto *arg : function->args()) {
+        bool is_pointer = ir::Type::base(arg->type())->is<ir::PointerType>();
+        m_attrs.at(function).readonly_args[i++] = is_pointer && !is_written_through(arg);
+    }
+}
+
+void Inferrer::infer_noalias(const ir::Function *function) {
+    // Gather every call of the function, which must be the only way it is used.
+    std::vector<const ir::CallInst *> calls;
+    std::vector<const ir::Function *> references{function};
+    if (auto it = m_declarations.find(function->name()); it != m_declarations.end()) {
+        references.insert(references.end(), it->second.begin(), it->second.end());
+    }
+    for (const auto *reference : references) {
+        for (const auto *user : reference->users()) {
+            const auto *call = as_inst<ir::CallInst>(user);
+            if (call == nullptr || call->callee() != reference ||
+                std::count(call->args().begin(), call->args().end(), reference) != 0) {
+                return;
+            }
+            calls.push_back(call);
+        }
+    }
+    if (calls.empty()) {
+        return;
+    }
+
+    auto &attrs = m_attrs.at(function);
+    for (std::size_t i = 0; const auto *arg : function->args()) {
+        const auto index = i++;
+        if (!ir::Type::base(arg->type())->is<ir::PointerType>()) {
+            continue;
+        }
+        attrs.noalias_args[index] = std::all_of(calls.begin(), calls.end(), [&](const ir::CallInst *call) {
+            const auto *var = pointer_root(call->args()[index])->as_or_null<ir::LocalVar>();
+            return var != nullptr && is_only_passed_to(var, call, index);
+        });
+    }
+}
+
+std::unordered_map<const ir::Function *, FunctionAttrs> Inferrer::run() {
+    for (const auto &[name, function] : m_definitions) {
+        attrs_of(function);
+    }
+    for (const auto &[name, function] : m_definitions) {
+        infer_noalias(function);
+    }
+    for (const auto &[name, declarations] : m_declarations) {
+        if (auto it = m_definitions.find(name); it != m_definitions.end()) {
+            for (const auto *declaration : declarations) {
+                m_attrs.emplace(declaration, m_attrs.at(it->second));
+            }
+        }
+    }
+    return std::move(m_attrs);
+}
+
+} // namespace
+
+std::unordered_map<const ir::Function *, FunctionAttrs> infer_function_attrs(const ir::Program *program) {
+    Inferrer inferrer(program);
+    return inferrer.run();
+}
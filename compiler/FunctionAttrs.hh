@@ -0,0 +1,34 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+namespace ir {
+
+class Function;
+class Program;
+
+} // namespace ir
+
+enum class MemoryEffect {
+    // Only accesses the function's own local variables.
+    None,
+    // May also read any memory.
+    ReadOnly,
+    Any,
+};
+
+/// @brief Properties of a function's body inferred from kodo semantics, which can be passed on to LLVM.
+struct FunctionAttrs {
+    MemoryEffect memory{MemoryEffect::Any};
+    bool will_return{false};
+    // Pointer arguments which are never written through, nor returned or otherwise allowed to escape.
+    std::vector<bool> readonly_args;
+    // Pointer arguments which always point to a local variable of the caller that isn't reachable in any other way.
+    std::vector<bool> noalias_args;
+};
+
+/// @brief Infers attributes for every function defined in `program`.
+/// @details Extern declarations of functions defined in the program share the attributes of the definition. Functions
+/// which aren't defined in the program have no entry.
+std::unordered_map<const ir::Function *, FunctionAttrs> infer_function_attrs(const ir::Program *program);
@@ -0,0 +1,207 @@
+#include <GlobalValueNumberer.hh>
+
+#include <analyses/AliasAnalysis.hh>
+#include <analyses/ControlFlowAnalysis.hh>
+#include <analyses/MemorySsaAnalysis.hh>
+#include <analyses/ReachingDefAnalysis.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <pass/PassManager.hh>
+#include <pass/PassUsage.hh>
+#include <support/Assert.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Expression {
+    ir::InstKind kind;
+    int op;
+    const ir::Type *type;
+    std::vector<ir::Value *> operands;
+
+    bool operator==(const Expression &) const = default;
+};
+
+struct ExpressionHash {
+    std::size_t operator()(const Expression &expression) const {
+        std::size_t hash = std::hash<int>{}(static_cast<int>(expression.kind));
+        hash = hash * 31 + std::hash<int>{}(expression.op);
+        hash = hash * 31 + std::hash<const ir::Type *>{}(expression.type);
+        for (auto *operand : expression.operands) {
+            hash = hash * 31 + std::hash<ir::Value *>{}(operand);
+        }
+        return hash;
+    }
+};
+
+class Numberer {
+    const AliasAnalysis *const m_aa;
+    const ControlFlowAnalysis *const m_cfa;
+    const MemorySsaAnalysis *const m_mssa;
+
+    std::unordered_map<Expression, ir::Instruction *, ExpressionHash> m_available;
+    std::unordered_map<ir::Instruction *, ir::Value *> m_replacements;
+    std::vector<ir::Instruction *> m_replaced;
+
+    ir::Value *leader(ir::Value *value) const;
+    ir::Value *forwarded_value(ir::LoadInst *load, ir::Value *clobber) const;
+    bool expression_of(ir::Instruction *inst, Expression &expression);
+    void replace(ir::Instruction *inst, ir::Value *repl);
+    void visit(ir::BasicBlock *block);
+
+public:
+    Numberer(const AliasAnalysis *aa, const ControlFlowAnalysis *cfa, const MemorySsaAnalysis *mssa)
+        : m_aa(aa), m_cfa(cfa), m_mssa(mssa) {}
+
+    void number();
+    const std::vector<ir::Instruction *> &replaced() const { return m_replaced; }
+    ir::Value *replacement(ir::Instruction *inst) const { return m_replacements.at(inst); }
+};
+
+ir::Value *Numberer::leader(ir::Value *value) const {
+    auto *inst = value != nullptr ? value->as_or_null<ir::Instruction>() : nullptr;
+    if (inst != nullptr && m_replacements.contains(inst)) {
+        return m_replacements.at(inst);
+    }
+    return value;
+}
+
+// Returns the value stored by `clobber` if it is a store to exactly the memory read by `load`.
+ir::Value *Numberer::forwarded_value(ir::LoadInst *load, ir::Value *clobber) const {
+    auto *def = clobber->as_or_null<MemoryDef>();
+    auto *store = def != nullptr && !def->is_live_on_entry() ? def->inst()->as_or_null<ir::StoreInst>() : nullptr;
+    if (store == nullptr || store->val()->type() != load->type()) {
+        return nullptr;
+    }
+    return m_aa->alias(store->ptr(), load->ptr()) == AliasResult::MustAlias ? leader(store->val()) : nullptr;
+}
+
+bool Numberer::expression_of(ir::Instruction *inst, Expression &expression) {
+    expression.kind = inst->kind();
+    expression.type = inst->type();
+    switch (inst->kind()) {
+    case ir::InstKind::Binary: {
+        auto *binary = inst->as<ir::BinaryInst>();
+        expression.op = static_cast<int>(binary->op());
+        expression.operands = {leader(binary->lhs()), leader(binary->rhs())};
+        if (binary->op() == ir::BinaryOp::Add || binary->op() == ir::BinaryOp::Mul) {
+            std::sort(expression.operands.begin(), expression.operands.end(), std::less<ir::Value *>());
+        }
+        return true;
+    }
+    case ir::InstKind::Cast: {
+        auto *cast = inst->as<ir::CastInst>();
+        expression.op = static_cast<int>(cast->op());
+        expression.operands = {leader(cast->val())};
+        return true;
+    }
+    case ir::InstKind::Compare: {
+        auto *compare = inst->as<ir::CompareInst>();
+        expression.op = static_cast<int>(compare->op());
+        expression.operands = {leader(compare->lhs()), leader(compare->rhs())};
+        return true;
+    }
+    case ir::InstKind::Lea: {
+        auto *lea = inst->as<ir::LeaInst>();
+        expression.op = 0;
+        expression.operands.push_back(leader(lea->ptr()));
+        for (auto *index : lea->indices()) {
+            expression.operands.push_back(leader(index));
+        }
+        return true;
+    }
+    case ir::InstKind::Load: {
+        // Loads from the same pointer are equivalent if nothing clobbers the memory in between.
+        auto *load = inst->as<ir::LoadInst>();
+        expression.op = 0;
+        expression.operands = {leader(load->ptr()), m_mssa->clobbering_access(load)};
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void Numberer::replace(ir::Instruction *inst, ir::Value *repl) {
+    ASSERT(repl == leader(repl));
+    m_replacements.emplace(inst, repl);
+    m_replaced.push_back(inst);
+}
+
+void Numberer::visit(ir::BasicBlock *block) {
+    std::vector<Expression> inserted;
+    for (auto *inst : *block) {
+        Expression expression;
+        if (!expression_of(inst, expression)) {
+            continue;
+        }
+        if (auto *load = inst->as_or_null<ir::LoadInst>()) {
+            if (auto *value = forwarded_value(load, expression.operands[1])) {
+                replace(load, value);
+                continue;
+            }
+        }
+        if (auto it = m_available.find(expression); it != m_available.end()) {
+            replace(inst, it->second);
+            continue;
+        }
+        m_available.emplace(expression, inst);
+        inserted.push_back(std::move(expression));
+    }
+
+    for (auto *dominatee : m_cfa->dominatees(block)) {
+        visit(dominatee);
+    }
+    for (const auto &expression : inserted) {
+        m_available.erase(expression);
+    }
+}
+
+void Numberer::number() {
+    visit(m_cfa->entry());
+}
+
+} // namespace
+
+void GlobalValueNumberer::build_usage(PassUsage *usage) {
+    usage->uses<AliasAnalysis>();
+    usage->uses<ControlFlowAnalysis>();
+    usage->uses<MemorySsaAnalysis>();
+}
+
+void GlobalValueNumberer::run(ir::Function *function) {
+    if (function->begin() == function->end()) {
+        return;
+    }
+
+    // Removing redundant loads can expose more equivalent expressions, and unifying leas can make more loads provably
+    // equivalent, so number until nothing changes.
+    auto *cfa = m_manager->get<ControlFlowAnalysis>(function);
+    while (true) {
+        auto *aa = m_manager->ensure<AliasAnalysis>(function);
+        Numberer numberer(aa, cfa, m_manager->ensure<MemorySsaAnalysis>(function));
+        numberer.number();
+        if (numberer.replaced().empty()) {
+            break;
+        }
+
+        // Memory phis may use the replaced values, so the memory analyses must be dropped first.
+        m_manager->invalidate<AliasAnalysis>(function);
+        m_manager->invalidate<MemorySsaAnalysis>(function);
+        m_manager->invalidate<ReachingDefAnalysis>(function);
+        for (auto *inst : numberer.replaced()) {
+            inst->replace_all_uses_with(numberer.replacement(inst));
+        }
+        for (auto *inst : numberer.replaced()) {
+            inst->remove_from_parent();
+        }
+    }
+}
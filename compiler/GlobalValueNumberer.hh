@@ -0,0 +1,14 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+/// @brief Dominator tree scoped global value numbering.
+/// @details Replaces pure instructions (binary, compare, cast and lea instructions) with an equivalent dominating
+/// instruction. Loads are numbered by their clobbering memory access, so redundant loads are removed and loads of a value
+/// just stored are forwarded the stored value.
+struct GlobalValueNumberer : public Pass {
+    constexpr explicit GlobalValueNumberer(PassManager *manager) : Pass(manager) {}
+
+    void build_usage(PassUsage *) override;
+    void run(ir::Function *) override;
+};
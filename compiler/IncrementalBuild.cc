@@ -0,0 +1,265 @@
+#include <IncrementalBuild.hh>
+
+#include <CharStream.hh>
+#include <Compiler.hh>
+#include <Lexer.hh>
+#include <ObjectEmitter.hh>
+#include <ir/Function.hh>
+#include <ir/Program.hh>
+#include <ir/Prototype.hh>
+#include <support/Error.hh>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/SHA1.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <system_error>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace {
+
+// Hashes a string along with its length so that adjacent components can't run into each other.
+void update(llvm::SHA1 &hasher, const std::string &str) {
+    hasher.update(std::to_string(str.size()));
+    hasher.update(":");
+    hasher.update(str);
+}
+
+std::string hash(const std::string &str) {
+    llvm::SHA1 hasher;
+    update(hasher, str);
+    return llvm::toHex(hasher.final(), true);
+}
+
+// Hashes the tokens of `source`, skipping over function bodies, so that only changes which could affect other files
+// change the hash.
+void update_with_declarations(llvm::SHA1 &hasher, const std::string &source) {
+    std::istringstream istream(source);
+    CharStream stream(&istream);
+    Lexer lexer(&stream);
+    // Whether the signature of a function is being lexed, and how deeply nested in its body the lexer is.
+    bool in_signature = false;
+    int body_depth = 0;
+    while (lexer.has_next()) {
+        auto token = lexer.next();
+        if (body_depth > 0) {
+            body_depth += token.kind == TokenKind::LBrace ? 1 : token.kind == TokenKind::RBrace ? -1 : 0;
+            continue;
+        }
+        if (in_signature && token.kind == TokenKind::LBrace) {
+            in_signature = false;
+            body_depth = 1;
+            continue;
+        }
+        if (token.kind == TokenKind::Fn) {
+            in_signature = true;
+        } else if (token.kind == TokenKind::Semi) {
+            in_signature = false;
+        }
+        update(hasher, tok_str(token));
+    }
+}
+
+struct FileRecord {
+    std::string source_hash;
+    std::string interface_hash;
+    std::vector<std::string> imports;
+    // Paths of transitively imported files mapped to their interface hashes.
+    std::map<std::string, std::string> dependencies;
+
+    bool operator==(const FileRecord &) const = default;
+};
+
+class BuildManifest {
+    const std::filesystem::path m_dir;
+    const std::string m_options_key;
+    std::map<std::string, FileRecord> m_files;
+
+    std::filesystem::path manifest_path() const { return m_dir / "manifest"; }
+
+public:
+    BuildManifest(std::filesystem::path dir, std::string options_key);
+
+    bool up_to_date(const std::string &path, const FileRecord &record) const;
+    std::filesystem::path object_path(const std::string &path) const;
+    void set(const std::string &path, FileRecord record) { m_files.insert_or_assign(path, std::move(record)); }
+    void remove(const std::string &path) { m_files.erase(path); }
+    void remove_unused(const std::unordered_map<std::string, FileRecord> &records);
+    void write() const;
+};
+
+BuildManifest::BuildManifest(std::filesystem::path dir, std::string options_key)
+    : m_dir(std::move(dir)), m_options_key(std::move(options_key)) {
+    std::ifstream stream(manifest_path());
+    std::string line;
+    if (!std::getline(stream, line) || line != "options " + m_options_key) {
+        return;
+    }
+    FileRecord *record = nullptr;
+    while (std::getline(stream, line)) {
+        auto space = line.find(' ');
+        if (space == std::string::npos) {
+            continue;
+        }
+        auto key = line.substr(0, space);
+        auto value = line.substr(space + 1);
+        if (key == "file") {
+            record = &m_files[value];
+        } else if (record == nullptr) {
+            continue;
+        } else if (key == "source") {
+            record->source_hash = value;
+        } else if (key == "interface") {
+            record->interface_hash = value;
+        } else if (key == "import") {
+            record->imports.push_back(value);
+        } else if (auto hash_start = value.rfind(' '); key == "dependency" && hash_start != std::string::npos) {
+            record->dependencies.emplace(value.substr(0, hash_start), value.substr(hash_start + 1));
+        }
+    }
+}
+
+bool BuildManifest::up_to_date(const std::string &path, const FileRecord &record) const {
+    auto it = m_files.find(path);
+    return it != m_files.end() && it->second == record && std::filesystem::exists(object_path(path));
+}
+
+std::filesystem::path BuildManifest::object_path(const std::string &path) const {
+    return m_dir / (hash(path) + ".o");
+}
+
+void BuildManifest::remove_unused(const std::unordered_map<std::string, FileRecord> &records) {
+    std::erase_if(m_files, [&](const auto &entry) {
+        return !records.contains(entry.first);
+    });
+
+    // Objects are swept from the directory rather than found through the records, since the records are all dropped
+    // when the options change.
+    std::unordered_set<std::string> used_objects;
+    for (const auto &[path, record] : records) {
+        used_objects.insert(object_path(path).filename().string());
+    }
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(m_dir, ec)) {
+        if (entry.path().extension() == ".o" && !used_objects.contains(entry.path().filename().string())) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+}
+
+void BuildManifest::write() const {
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+    std::ofstream stream(manifest_path());
+    stream << "options " << m_options_key << '\n';
+    for (const auto &[path, record] : m_files) {
+        stream << "file " << path << '\n';
+        stream << "source " << record.source_hash << '\n';
+        stream << "interface " << record.interface_hash << '\n';
+        for (const auto &import_path : record.imports) {
+            stream << "import " << import_path << '\n';
+        }
+        for (const auto &[dependency, interface_hash] : record.dependencies) {
+            stream << "dependency " << dependency << ' ' << interface_hash << '\n';
+        }
+    }
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<llvm::MemoryBuffer>>
+emit_incremental_objects(const std::vector<SourceFile> &files, const ir::Program *program, const llvm::Module &module,
+                         const std::filesystem::path &dir, const std::string &options_key,
+                         const std::function<std::unique_ptr<llvm::TargetMachine>()> &create_machine,
+                         std::size_t &rebuilt_count) {
+    // Attribute every defined function to the file it was defined in.
+    std::unordered_map<std::string, std::string> function_files;
+    for (const auto *function : *program) {
+        if (!function->prototype()->externed()) {
+            function_files.emplace(function->name(), function->file());
+        }
+    }
+    std::unordered_map<std::string, std::vector<const llvm::Function *>> file_functions;
+    for (const auto &function : module) {
+        if (!function.isDeclaration()) {
+            file_functions[function_files.at(function.getName().str())].push_back(&function);
+        }
+    }
+
+    // Imported files always come before the files importing them, so their records are complete by the time they're
+    // needed.
+    std::unordered_map<std::string, FileRecord> records;
+    for (const auto &file : files) {
+        auto &record = records[file.path];
+        record.source_hash = hash(file.source);
+        record.imports = file.imports;
+        for (const auto &import_path : file.imports) {
+            // Files in an import cycle can't see each other's records yet.
+            auto it = records.find(import_path);
+            if (it == records.end() || it->second.interface_hash.empty()) {
+                continue;
+            }
+            record.dependencies.emplace(import_path, it->second.interface_hash);
+            record.dependencies.insert(it->second.dependencies.begin(), it->second.dependencies.end());
+        }
+
+        llvm::SHA1 hasher;
+        update_with_declarations(hasher, file.source);
+        for (const auto *function : file_functions[file.path]) {
+            std::string signature;
+            llvm::raw_string_ostream signature_stream(signature);
+            signature_stream << function->getName() << ' ' << *function->getFunctionType() << ' ';
+            function->getAttributes().print(signature_stream);
+            update(hasher, signature_stream.str());
+        }
+        record.interface_hash = llvm::toHex(hasher.final(), true);
+    }
+
+    // Stale records are dropped before any objects are overwritten, so that an interrupted build can't leave an object
+    // that doesn't match its record. Files which are no longer imported are forgotten along with their objects.
+    BuildManifest manifest(dir, options_key);
+    manifest.remove_unused(records);
+    std::vector<const SourceFile *> stale_files;
+    for (const auto &file : files) {
+        if (!manifest.up_to_date(file.path, records.at(file.path))) {
+            manifest.remove(file.path);
+            stale_files.push_back(&file);
+        }
+    }
+    manifest.write();
+    for (const auto *file : stale_files) {
+        auto object = emit_partial_object(
+            module,
+            [&](const llvm::GlobalValue &global) {
+                // Mutable globals are defined by the main file.
+                if (!llvm::isa<llvm::Function>(global)) {
+                    return file == &files.back();
+                }
+                return function_files.at(global.getName().str()) == file->path;
+            },
+            *create_machine());
+        auto object_path = manifest.object_path(file->path);
+        std::ofstream stream(object_path, std::ios::binary);
+        stream.write(object->getBufferStart(), static_cast<std::streamsize>(object->getBufferSize()));
+    }
+    for (const auto &file : files) {
+        manifest.set(file.path, std::move(records.at(file.path)));
+    }
+    manifest.write();
+    rebuilt_count = stale_files.size();
+
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects;
+    for (const auto &file : files) {
+        auto object = llvm::MemoryBuffer::getFile(manifest.object_path(file.path).string());
+        if (!object) {
+            print_error_and_abort("Could not read object for {}", file.path);
+        }
+        objects.push_back(std::move(*object));
+    }
+    return objects;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ir {
+
+class Program;
+
+} // namespace ir
+
+struct SourceFile;
+
+/// @brief Emits one object per source file for --incremental, reusing objects from previous builds where possible.
+/// @details The objects are kept in `dir` along with a manifest recording, for each file, a hash of its source, its
+/// imports, a hash of its interface and the interface hashes of the files it (transitively) imports. A file's
+/// interface is everything another file can depend on: its declarations, leaving out function bodies, and the
+/// signatures and attributes of the functions it defines. An object is only regenerated when its file's source or
+/// interface, or the interface of one of its dependencies, has changed. The whole manifest is discarded when
+/// `options_key` changes, and objects no longer belonging to any file in the program are deleted.
+/// @param rebuilt_count Set to the number of objects which had to be regenerated.
+std::vector<std::unique_ptr<llvm::MemoryBuffer>>
+emit_incremental_objects(const std::vector<SourceFile> &files, const ir::Program *program, const llvm::Module &module,
+                         const std::filesystem::path &dir, const std::string &options_key,
+                         const std::function<std::unique_ptr<llvm::TargetMachine>()> &create_machine,
+                         std::size_t &rebuilt_count);
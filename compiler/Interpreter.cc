@@ -0,0 +1,935 @@
+#include <Interpreter.hh>
+
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/DataLayout.hh>
+#include <ir/Function.hh>
+#include <ir/GlobalVariable.hh>
+#include <ir/Instructions.hh>
+#include <ir/Program.hh>
+#include <ir/Types.hh>
+#include <support/Assert.hh>
+#include <support/Box.hh>
+#include <support/Error.hh>
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+constexpr std::uint32_t k_none = std::numeric_limits<std::uint32_t>::max();
+constexpr std::size_t k_register_stack_size = 1024 * 1024;
+constexpr std::size_t k_memory_stack_size = 8 * 1024 * 1024;
+
+// Extern functions are called with every argument in a register, so they can take at most as many as the calling
+// convention passes in registers.
+constexpr std::uint32_t k_max_native_args = 6;
+
+// The order here must match the dispatch table in `Interpreter::execute`.
+enum class Opcode : std::uint8_t {
+    // dst = a op b, truncated to imm bits.
+    Add,
+    Sub,
+    Mul,
+    Div,
+
+    // dst = a op b, with both operands sign extended from imm bits.
+    CompareLessThan,
+    CompareGreaterThan,
+
+    // Copies c slots from a to dst.
+    Move,
+    // dst = a sign extended from imm bits, truncated to b bits.
+    SignExtend,
+    // dst = a truncated to imm bits.
+    Truncate,
+
+    // dst = a + imm + the sum of the scaled lea terms [b, b + c).
+    Lea,
+    // Loads imm bytes from a into dst.
+    Load,
+    // Stores imm bytes from b into a.
+    Store,
+    // Copies c bytes from b to a.
+    Copy,
+
+    // Takes edge a.
+    Branch,
+    // Takes edge b if a is true, otherwise edge c.
+    CondBranch,
+
+    // Calls function a, callee a or native function a with the args [b, b + c), storing the result in dst.
+    Call,
+    CallIndirect,
+    CallNative,
+    // Emulates the syscall described by asm call a.
+    Syscall,
+
+    // Returns c slots from a.
+    Ret,
+    RetVoid,
+};
+
+struct Op {
+    Opcode opcode;
+    std::uint32_t dst{k_none};
+    std::uint32_t a{k_none};
+    std::uint32_t b{k_none};
+    std::uint32_t c{k_none};
+    std::int64_t imm{0};
+};
+
+// A value occupying `count` consecutive slots. Aggregates take up more than one slot.
+struct Operand {
+    std::uint32_t slot;
+    std::uint32_t count;
+};
+
+struct Move {
+    std::uint32_t dst;
+    std::uint32_t src;
+    std::uint32_t count;
+};
+
+// A control flow edge, with the moves needed to set up the phis of the target block. Since the CFG is acyclic, a phi
+// can never be an incoming value of a phi in the same block, so the moves can be performed in order.
+struct Edge {
+    std::uint32_t target;
+    std::uint32_t moves_begin;
+    std::uint32_t moves_end;
+};
+
+struct LeaTerm {
+    std::uint32_t slot;
+    std::int64_t bit_width;
+    std::int64_t scale;
+};
+
+// The argument registers of a syscall, in the order rax, rdi, rsi, rdx, r10, r8, r9.
+constexpr std::array<const char *, 7> k_syscall_registers{"rax", "rdi", "rsi", "rdx", "r10", "r8", "r9"};
+
+struct AsmCall {
+    std::array<std::uint32_t, k_syscall_registers.size()> inputs;
+    std::uint32_t output;
+    std::size_t output_size;
+};
+
+struct Code {
+    std::vector<Op> ops;
+    std::vector<Edge> edges;
+    std::vector<Move> moves;
+    std::vector<LeaTerm> lea_terms;
+    std::vector<Operand> args;
+    std::vector<AsmCall> asm_calls;
+    std::vector<Operand> params;
+    // Slot and frame memory offset pairs for local vars.
+    std::vector<std::pair<std::uint32_t, std::size_t>> vars;
+    // Initial frame contents, which holds all the constants used by the function.
+    std::vector<std::uint64_t> frame;
+    std::size_t memory_size{0};
+};
+
+std::size_t align_to(std::size_t value, std::size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+std::int64_t bit_width(const ir::Type *type) {
+    if (const auto *int_type = ir::Type::base_as<ir::IntType>(type)) {
+        return int_type->bit_width();
+    }
+    return ir::Type::base(type)->kind() == ir::TypeKind::Bool ? 1 : 64;
+}
+
+std::uint32_t slot_count(const ir::Type *type) {
+    return static_cast<std::uint32_t>(align_to(ir::size_of(type), 8) / 8);
+}
+
+std::uint64_t truncate(std::uint64_t value, std::int64_t bit_width) {
+    return bit_width >= 64 ? value : value & ((std::uint64_t(1) << bit_width) - 1);
+}
+
+std::int64_t sign_extend(std::uint64_t value, std::int64_t bit_width) {
+    if (bit_width >= 64) {
+        return static_cast<std::int64_t>(value);
+    }
+    const auto shift = 64 - bit_width;
+    return static_cast<std::int64_t>(value << shift) >> shift;
+}
+
+const ir::Type *pointee_type(const ir::Type *type) {
+    return ir::Type::base_as<ir::PointerType>(type)->pointee_type();
+}
+
+std::uint64_t syscall_result(std::int64_t result) {
+    return static_cast<std::uint64_t>(result == -1 ? -errno : result);
+}
+
+using SyscallArgs = std::array<std::uint64_t, k_syscall_registers.size() - 1>;
+
+struct SyscallEntry {
+    std::uint64_t number;
+    std::uint64_t (*emulate)(const SyscallArgs &args);
+};
+
+// Syscalls are emulated with their libc wrappers rather than passed through blindly.
+const std::array k_syscalls{
+    SyscallEntry{1,
+                 [](const SyscallArgs &args) {
+                     const auto *buf = reinterpret_cast<const void *>(args[1]);
+                     return syscall_result(::write(static_cast<int>(args[0]), buf, args[2]));
+                 }},
+    SyscallEntry{2,
+                 [](const SyscallArgs &args) {
+                     const auto *path = reinterpret_cast<const char *>(args[0]);
+                     return syscall_result(::open(path, static_cast<int>(args[1]), static_cast<mode_t>(args[2])));
+                 }},
+    SyscallEntry{3, [](const SyscallArgs &args) { return syscall_result(::close(static_cast<int>(args[0]))); }},
+    SyscallEntry{8,
+                 [](const SyscallArgs &args) {
+                     auto offset = static_cast<off_t>(args[1]);
+                     return syscall_result(::lseek(static_cast<int>(args[0]), offset, static_cast<int>(args[2])));
+                 }},
+    SyscallEntry{9,
+                 [](const SyscallArgs &args) {
+                     auto *addr = reinterpret_cast<void *>(args[0]);
+                     auto *ptr = ::mmap(addr, args[1], static_cast<int>(args[2]), static_cast<int>(args[3]),
+                                        static_cast<int>(args[4]), static_cast<off_t>(args[5]));
+                     return ptr != MAP_FAILED ? reinterpret_cast<std::uint64_t>(ptr) : syscall_result(-1);
+                 }},
+    SyscallEntry{11,
+                 [](const SyscallArgs &args) {
+                     return syscall_result(::munmap(reinterpret_cast<void *>(args[0]), args[1]));
+                 }},
+    SyscallEntry{60,
+                 [](const SyscallArgs &args) -> std::uint64_t {
+                     std::exit(static_cast<int>(args[0]));
+                 }},
+};
+
+class Interpreter {
+    std::unordered_map<std::string, const ir::Function *> m_definitions;
+    std::unordered_map<const ir::Function *, std::uint32_t> m_function_indices;
+    std::vector<const ir::Function *> m_functions;
+    std::vector<Box<Code>> m_code;
+    std::unordered_map<std::string, std::uint32_t> m_native_indices;
+    std::vector<void *> m_natives;
+
+    std::unordered_map<const ir::GlobalVariable *, std::byte *> m_global_addresses;
+    std::deque<std::vector<std::byte>> m_global_memory;
+    std::unordered_map<const ir::ConstantString *, const char *> m_string_addresses;
+    std::deque<std::string> m_strings;
+
+    std::unique_ptr<std::uint64_t[]> m_registers;
+    std::unique_ptr<std::byte[]> m_memory;
+    std::size_t m_register_top{0};
+    std::size_t m_memory_top{0};
+
+    const Code &code(std::uint32_t index);
+    void call(std::uint32_t index, const Operand *args, std::uint32_t arg_count, const std::uint64_t *caller_frame,
+              std::uint64_t *ret);
+    void call_native(std::uint32_t index, const Operand *args, std::uint32_t arg_count,
+                     const std::uint64_t *caller_frame, std::uint64_t *ret, std::int64_t ret_bit_width);
+    void execute(const Code &code, std::uint64_t *frame, std::uint64_t *ret);
+
+public:
+    explicit Interpreter(const ir::Program *program);
+
+    const ir::Function *canonical_function(const ir::Function *function) const;
+    std::uint32_t function_index(const ir::Function *function);
+    std::uint32_t native_index(const std::string &name);
+    std::byte *global_address(const ir::GlobalVariable *global);
+    void write_constant(std::byte *dst, const ir::Value *value);
+    int run();
+};
+
+class Translator {
+    Interpreter *const m_interpreter;
+    const ir::Function *const m_function;
+    Box<Code> m_code;
+    std::unordered_map<const ir::Value *, std::uint32_t> m_slots;
+    std::unordered_map<const ir::BasicBlock *, std::uint32_t> m_block_pcs;
+    std::vector<std::pair<std::uint32_t, const ir::BasicBlock *>> m_unresolved_edges;
+
+    std::uint32_t allocate_slots(std::uint32_t count);
+    std::uint32_t slot_of(const ir::Value *value);
+    Operand operand(const ir::Value *value);
+    std::uint32_t edge(const ir::BasicBlock *pred, const ir::BasicBlock *succ);
+    Op &emit(Opcode opcode);
+
+    void translate_binary(const ir::BinaryInst *);
+    void translate_call(const ir::CallInst *);
+    void translate_cast(const ir::CastInst *);
+    void translate_compare(const ir::CompareInst *);
+    void translate_inline_asm(const ir::InlineAsmInst *);
+    void translate_lea(const ir::LeaInst *);
+    void translate_instruction(const ir::Instruction *);
+
+public:
+    Translator(Interpreter *interpreter, const ir::Function *function)
+        : m_interpreter(interpreter), m_function(function), m_code(Box<Code>::create()) {}
+
+    Box<Code> translate();
+};
+
+std::uint32_t Translator::allocate_slots(std::uint32_t count) {
+    auto slot = static_cast<std::uint32_t>(m_code->frame.size());
+    m_code->frame.resize(m_code->frame.size() + std::max(count, 1u));
+    return slot;
+}
+
+std::uint32_t Translator::slot_of(const ir::Value *value) {
+    if (auto it = m_slots.find(value); it != m_slots.end()) {
+        return it->second;
+    }
+
+    // Anything not already assigned a slot is a constant, which gets stored in the initial frame.
+    std::uint32_t slot = 0;
+    switch (value->kind()) {
+    case ir::ValueKind::Constant:
+        slot = allocate_slots(slot_count(value->type()));
+        break;
+    case ir::ValueKind::Function:
+    case ir::ValueKind::GlobalVariable:
+        slot = allocate_slots(1);
+        break;
+    default:
+        ENSURE_NOT_REACHED();
+    }
+    m_interpreter->write_constant(reinterpret_cast<std::byte *>(&m_code->frame[slot]), value);
+    m_slots.emplace(value, slot);
+    return slot;
+}
+
+Operand Translator::operand(const ir::Value *value) {
+    return {slot_of(value), std::max(slot_count(value->type()), 1u)};
+}
+
+std::uint32_t Translator::edge(const ir::BasicBlock *pred, const ir::BasicBlock *succ) {
+    auto moves_begin = static_cast<std::uint32_t>(m_code->moves.size());
+    for (const auto *inst : *succ) {
+        const auto *phi = inst->as_or_null<ir::PhiInst>();
+        if (phi == nullptr) {
+            break;
+        }
+        auto it = phi->incoming().find(const_cast<ir::BasicBlock *>(pred));
+        if (it != phi->incoming().end()) {
+            auto incoming = operand(it->second);
+            m_code->moves.push_back({slot_of(phi), incoming.slot, incoming.count});
+        }
+    }
+    auto index = static_cast<std::uint32_t>(m_code->edges.size());
+    m_code->edges.push_back({k_none, moves_begin, static_cast<std::uint32_t>(m_code->moves.size())});
+    m_unresolved_edges.emplace_back(index, succ);
+    return index;
+}
+
+Op &Translator::emit(Opcode opcode) {
+    return m_code->ops.emplace_back(Op{opcode});
+}
+
+void Translator::translate_binary(const ir::BinaryInst *binary) {
+    static constexpr std::array opcodes{Opcode::Add, Opcode::Sub, Opcode::Mul, Opcode::Div};
+    auto &op = emit(opcodes[static_cast<std::size_t>(binary->op())]);
+    op.dst = slot_of(binary);
+    op.a = slot_of(binary->lhs());
+    op.b = slot_of(binary->rhs());
+    op.imm = bit_width(binary->type());
+}
+
+void Translator::translate_call(const ir::CallInst *call) {
+    auto args_begin = static_cast<std::uint32_t>(m_code->args.size());
+    for (const auto *arg : call->args()) {
+        m_code->args.push_back(operand(arg));
+    }
+
+    const auto *return_type = call->callee_function_type()->return_type();
+    const auto *callee = call->callee()->as_or_null<ir::Function>();
+    Op *op = nullptr;
+    if (callee == nullptr) {
+        op = &emit(Opcode::CallIndirect);
+        op->a = slot_of(call->callee());
+    } else if (callee = m_interpreter->canonical_function(callee); callee->prototype()->externed()) {
+        if (call->args().size() > k_max_native_args) {
+            print_error_and_abort("interpreter cannot call extern functions with more than {} arguments",
+                                  k_max_native_args);
+        }
+        op = &emit(Opcode::CallNative);
+        op->a = m_interpreter->native_index(callee->name());
+        op->imm = ir::Type::base(return_type)->kind() != ir::TypeKind::Void ? bit_width(return_type) : 0;
+    } else {
+        op = &emit(Opcode::Call);
+        op->a = m_interpreter->function_index(callee);
+    }
+    op->b = args_begin;
+    op->c = static_cast<std::uint32_t>(call->args().size());
+    if (m_slots.contains(call)) {
+        op->dst = slot_of(call);
+    }
+}
+
+void Translator::translate_cast(const ir::CastInst *cast) {
+    const auto from_width = bit_width(cast->val()->type());
+    const auto to_width = bit_width(cast->type());
+    switch (cast->op()) {
+    case ir::CastOp::SignExtend: {
+        auto &op = emit(Opcode::SignExtend);
+        op.dst = slot_of(cast);
+        op.a = slot_of(cast->val());
+        op.b = static_cast<std::uint32_t>(to_width);
+        op.imm = from_width;
+        return;
+    }
+    case ir::CastOp::PtrToInt:
+    case ir::CastOp::Truncate: {
+        auto &op = emit(Opcode::Truncate);
+        op.dst = slot_of(cast);
+        op.a = slot_of(cast->val());
+        op.imm = to_width;
+        return;
+    }
+    default: {
+        // Values are always kept zero extended, so everything else is a plain move.
+        auto val = operand(cast->val());
+        auto &op = emit(Opcode::Move);
+        op.dst = slot_of(cast);
+        op.a = val.slot;
+        op.c = val.count;
+        return;
+    }
+    }
+}
+
+void Translator::translate_compare(const ir::CompareInst *compare) {
+    auto &op = emit(compare->op() == ir::CompareOp::LessThan ? Opcode::CompareLessThan : Opcode::CompareGreaterThan);
+    op.dst = slot_of(compare);
+    op.a = slot_of(compare->lhs());
+    op.b = slot_of(compare->rhs());
+    op.imm = bit_width(compare->lhs()->type());
+}
+
+void Translator::translate_inline_asm(const ir::InlineAsmInst *inline_asm) {
+    if (inline_asm->instruction() != "syscall") {
+        print_error_and_abort("interpreter cannot execute inline asm '{}'", inline_asm->instruction());
+    }
+    auto register_index = [](const std::string &reg) {
+        for (std::size_t i = 0; i < k_syscall_registers.size(); i++) {
+            if (reg == k_syscall_registers[i]) {
+                return i;
+            }
+        }
+        print_error_and_abort("interpreter cannot emulate syscall register '{}'", reg);
+    };
+
+    AsmCall asm_call{};
+    asm_call.inputs.fill(k_none);
+    asm_call.output = k_none;
+    for (const auto &[reg, value] : inline_asm->inputs()) {
+        asm_call.inputs[register_index(reg)] = slot_of(value);
+    }
+    for (const auto &[reg, value] : inline_asm->outputs()) {
+        if (reg != "rax") {
+            print_error_and_abort("interpreter cannot emulate syscall output register '{}'", reg);
+        }
+        asm_call.output = slot_of(value);
+        asm_call.output_size = ir::size_of(value->as<ir::LocalVar>()->var_type());
+    }
+    auto &op = emit(Opcode::Syscall);
+    op.a = static_cast<std::uint32_t>(m_code->asm_calls.size());
+    m_code->asm_calls.push_back(asm_call);
+}
+
+void Translator::translate_lea(const ir::LeaInst *lea) {
+    auto terms_begin = static_cast<std::uint32_t>(m_code->lea_terms.size());
+    std::int64_t offset = 0;
+    auto add_index = [&](const ir::Value *index, std::size_t scale) {
+        const auto *constant = index->as_or_null<ir::Constant>();
+        const auto *constant_int = constant != nullptr ? constant->as_or_null<ir::ConstantInt>() : nullptr;
+        if (constant_int != nullptr) {
+            offset += sign_extend(constant_int->value(), bit_width(index->type())) * static_cast<std::int64_t>(scale);
+            return;
+        }
+        m_code->lea_terms.push_back({slot_of(index), bit_width(index->type()), static_cast<std::int64_t>(scale)});
+    };
+
+    // A lea with a single index offsets the pointer by its own pointee type, as with LLVM's GEP.
+    const auto &indices = lea->indices();
+    if (indices.size() == 1) {
+        add_index(indices[0], ir::size_of(pointee_type(lea->type())));
+    } else {
+        const auto *type = pointee_type(lea->ptr()->type());
+        add_index(indices[0], ir::size_of(type));
+        for (std::size_t i = 1; i < indices.size(); i++) {
+            type = ir::Type::base(type);
+            if (const auto *struct_type = type->as_or_null<ir::StructType>()) {
+                const auto *index = indices[i]->as<ir::Constant>()->as<ir::ConstantInt>();
+                offset += static_cast<std::int64_t>(ir::field_offset(struct_type, index->value()));
+                type = struct_type->fields()[index->value()].type();
+                continue;
+            }
+            type = type->as<ir::ArrayType>()->element_type();
+            add_index(indices[i], ir::size_of(type));
+        }
+    }
+
+    auto &op = emit(Opcode::Lea);
+    op.dst = slot_of(lea);
+    op.a = slot_of(lea->ptr());
+    op.b = terms_begin;
+    op.c = static_cast<std::uint32_t>(m_code->lea_terms.size()) - terms_begin;
+    op.imm = offset;
+}
+
+void Translator::translate_instruction(const ir::Instruction *instruction) {
+    switch (instruction->kind()) {
+    case ir::InstKind::Binary:
+        translate_binary(instruction->as<ir::BinaryInst>());
+        break;
+    case ir::InstKind::Branch: {
+        const auto *branch = instruction->as<ir::BranchInst>();
+        auto &op = emit(Opcode::Branch);
+        op.a = edge(branch->parent(), branch->dst());
+        break;
+    }
+    case ir::InstKind::Call:
+        translate_call(instruction->as<ir::CallInst>());
+        break;
+    case ir::InstKind::Cast:
+        translate_cast(instruction->as<ir::CastInst>());
+        break;
+    case ir::InstKind::Compare:
+        translate_compare(instruction->as<ir::CompareInst>());
+        break;
+    case ir::InstKind::CondBranch: {
+        const auto *cond_branch = instruction->as<ir::CondBranchInst>();
+        auto true_edge = edge(cond_branch->parent(), cond_branch->true_dst());
+        auto false_edge = edge(cond_branch->parent(), cond_branch->false_dst());
+        auto &op = emit(Opcode::CondBranch);
+        op.a = slot_of(cond_branch->cond());
+        op.b = true_edge;
+        op.c = false_edge;
+        break;
+    }
+    case ir::InstKind::Copy: {
+        const auto *copy = instruction->as<ir::CopyInst>();
+        auto &op = emit(Opcode::Copy);
+        op.a = slot_of(copy->dst());
+        op.b = slot_of(copy->src());
+        op.c = slot_of(copy->len());
+        break;
+    }
+    case ir::InstKind::InlineAsm:
+        translate_inline_asm(instruction->as<ir::InlineAsmInst>());
+        break;
+    case ir::InstKind::Lea:
+        translate_lea(instruction->as<ir::LeaInst>());
+        break;
+    case ir::InstKind::Load: {
+        const auto *load = instruction->as<ir::LoadInst>();
+        auto &op = emit(Opcode::Load);
+        op.dst = slot_of(load);
+        op.a = slot_of(load->ptr());
+        op.imm = static_cast<std::int64_t>(ir::size_of(load->type()));
+        break;
+    }
+    case ir::InstKind::Phi:
+        // Phis are handled by the moves on incoming edges.
+        break;
+    case ir::InstKind::Store: {
+        const auto *store = instruction->as<ir::StoreInst>();
+        auto &op = emit(Opcode::Store);
+        op.a = slot_of(store->ptr());
+        op.b = slot_of(store->val());
+        op.imm = static_cast<std::int64_t>(ir::size_of(store->val()->type()));
+        break;
+    }
+    case ir::InstKind::Ret: {
+        const auto *ret = instruction->as<ir::RetInst>();
+        if (ret->val() == nullptr) {
+            emit(Opcode::RetVoid);
+            break;
+        }
+        auto val = operand(ret->val());
+        auto &op = emit(Opcode::Ret);
+        op.a = val.slot;
+        op.c = val.count;
+        break;
+    }
+    default:
+        ENSURE_NOT_REACHED();
+    }
+}
+
+Box<Code> Translator::translate() {
+    for (const auto *arg : m_function->args()) {
+        auto count = slot_count(arg->type());
+        m_code->params.push_back({allocate_slots(count), count});
+        m_slots.emplace(arg, m_code->params.back().slot);
+    }
+    for (const auto *var : m_function->vars()) {
+        m_code->memory_size = align_to(m_code->memory_size, ir::align_of(var->var_type()));
+        m_code->vars.emplace_back(allocate_slots(1), m_code->memory_size);
+        m_code->memory_size += ir::size_of(var->var_type());
+        m_slots.emplace(var, m_code->vars.back().first);
+    }
+
+    // Assign every instruction a slot up front, since an instruction may be used in a block that comes before it.
+    for (const auto *block : *m_function) {
+        for (const auto *inst : *block) {
+            if (inst->type() != nullptr && ir::Type::base(inst->type())->kind() != ir::TypeKind::Void) {
+                m_slots.emplace(inst, allocate_slots(slot_count(inst->type())));
+            }
+        }
+    }
+
+    for (auto it = m_function->begin(); it != m_function->end(); ++it) {
+        const auto *block = *it;
+        m_block_pcs.emplace(block, static_cast<std::uint32_t>(m_code->ops.size()));
+        for (const auto *inst : *block) {
+            translate_instruction(inst);
+        }
+
+        // Blocks without a terminator fall through to the next block.
+        const auto *last = !block->empty() ? block->terminator() : nullptr;
+        if (last != nullptr && (last->kind() == ir::InstKind::Branch || last->kind() == ir::InstKind::CondBranch ||
+                                last->kind() == ir::InstKind::Ret)) {
+            continue;
+        }
+        auto next = it;
+        if (++next == m_function->end()) {
+            emit(Opcode::RetVoid);
+            continue;
+        }
+        auto &op = emit(Opcode::Branch);
+        op.a = edge(block, *next);
+    }
+    for (auto [index, block] : m_unresolved_edges) {
+        m_code->edges[index].target = m_block_pcs.at(block);
+    }
+    return std::move(m_code);
+}
+
+Interpreter::Interpreter(const ir::Program *program)
+    : m_registers(new std::uint64_t[k_register_stack_size]), m_memory(new std::byte[k_memory_stack_size]) {
+    for (const auto *function : *program) {
+        if (!function->prototype()->externed()) {
+            m_definitions.emplace(function->name(), function);
+        }
+    }
+}
+
+const ir::Function *Interpreter::canonical_function(const ir::Function *function) const {
+    // Extern declarations of functions defined elsewhere in the program (such as `main`) refer to the definition.
+    if (function->prototype()->externed()) {
+        if (auto it = m_definitions.find(function->name()); it != m_definitions.end()) {
+            return it->second;
+        }
+    }
+    return function;
+}
+
+std::uint32_t Interpreter::function_index(const ir::Function *function) {
+    function = canonical_function(function);
+    if (auto it = m_function_indices.find(function); it != m_function_indices.end()) {
+        return it->second;
+    }
+    auto index = static_cast<std::uint32_t>(m_functions.size());
+    m_functions.push_back(function);
+    m_code.emplace_back();
+    m_function_indices.emplace(function, index);
+    return index;
+}
+
+std::uint32_t Interpreter::native_index(const std::string &name) {
+    if (auto it = m_native_indices.find(name); it != m_native_indices.end()) {
+        return it->second;
+    }
+    auto *native = ::dlsym(RTLD_DEFAULT, name.c_str());
+    if (native == nullptr) {
+        print_error_and_abort("undefined symbol '{}'", name);
+    }
+    auto index = static_cast<std::uint32_t>(m_natives.size());
+    m_natives.push_back(native);
+    m_native_indices.emplace(name, index);
+    return index;
+}
+
+std::byte *Interpreter::global_address(const ir::GlobalVariable *global) {
+    if (auto it = m_global_addresses.find(global); it != m_global_addresses.end()) {
+        return it->second;
+    }
+    auto &memory = m_global_memory.emplace_back(ir::size_of(global->initialiser()->type()));
+    m_global_addresses.emplace(global, memory.data());
+    write_constant(memory.data(), global->initialiser());
+    return memory.data();
+}
+
+void Interpreter::write_constant(std::byte *dst, const ir::Value *value) {
+    auto write = [dst](const auto &bytes, std::size_t size) {
+        std::memcpy(dst, &bytes, size);
+    };
+    if (const auto *function = value->as_or_null<ir::Function>()) {
+        const auto *canonical = canonical_function(function);
+        write(canonical, sizeof(canonical));
+        return;
+    }
+    if (const auto *global = value->as_or_null<ir::GlobalVariable>()) {
+        write(global_address(global), sizeof(std::byte *));
+        return;
+    }
+
+    const auto *constant = value->as<ir::Constant>();
+    switch (constant->kind()) {
+    case ir::ConstantKind::Array: {
+        const auto *constant_array = constant->as<ir::ConstantArray>();
+        const auto *element_type = constant_array->type()->as<ir::ArrayType>()->element_type();
+        for (std::size_t i = 0; const auto *elem : constant_array->elems()) {
+            write_constant(dst + i++ * ir::size_of(element_type), elem);
+        }
+        break;
+    }
+    case ir::ConstantKind::Int:
+        write(constant->as<ir::ConstantInt>()->value(), ir::size_of(constant->type()));
+        break;
+    case ir::ConstantKind::String: {
+        const auto *constant_string = constant->as<ir::ConstantString>();
+        if (!m_string_addresses.contains(constant_string)) {
+            m_string_addresses.emplace(constant_string, m_strings.emplace_back(constant_string->value()).c_str());
+        }
+        write(m_string_addresses.at(constant_string), sizeof(const char *));
+        break;
+    }
+    default:
+        // Null and undef are both zero, which the destination already is.
+        break;
+    }
+}
+
+const Code &Interpreter::code(std::uint32_t index) {
+    if (*m_code[index] == nullptr) {
+        m_code[index] = Translator(this, m_functions[index]).translate();
+    }
+    return **m_code[index];
+}
+
+void Interpreter::call(std::uint32_t index, const Operand *args, std::uint32_t arg_count,
+                       const std::uint64_t *caller_frame, std::uint64_t *ret) {
+    const auto &callee = code(index);
+    const auto memory_base = align_to(m_memory_top, 16);
+    if (m_register_top + callee.frame.size() > k_register_stack_size ||
+        memory_base + callee.memory_size > k_memory_stack_size) {
+        print_error_and_abort("interpreter stack overflow");
+    }
+
+    auto *frame = &m_registers[m_register_top];
+    std::memcpy(frame, callee.frame.data(), callee.frame.size() * sizeof(std::uint64_t));
+    ASSERT(arg_count == callee.params.size());
+    for (std::uint32_t i = 0; i < arg_count; i++) {
+        std::memcpy(&frame[callee.params[i].slot], &caller_frame[args[i].slot], args[i].count * sizeof(std::uint64_t));
+    }
+    for (auto [slot, offset] : callee.vars) {
+        frame[slot] = reinterpret_cast<std::uint64_t>(&m_memory[memory_base + offset]);
+    }
+
+    const auto register_top = std::exchange(m_register_top, m_register_top + callee.frame.size());
+    const auto memory_top = std::exchange(m_memory_top, memory_base + callee.memory_size);
+    execute(callee, frame, ret);
+    m_register_top = register_top;
+    m_memory_top = memory_top;
+}
+
+void Interpreter::call_native(std::uint32_t index, const Operand *args, std::uint32_t arg_count,
+                              const std::uint64_t *caller_frame, std::uint64_t *ret, std::int64_t ret_bit_width) {
+    // All values passed to extern functions are integers or pointers, so passing unused argument registers is harmless.
+    using NativeFunction = std::uint64_t (*)(std::uint64_t, std::uint64_t, std::uint64_t, std::uint64_t,
+                                             std::uint64_t, std::uint64_t);
+    std::array<std::uint64_t, k_max_native_args> values{};
+    for (std::uint32_t i = 0; i < arg_count; i++) {
+        values[i] = caller_frame[args[i].slot];
+    }
+    auto *native = reinterpret_cast<NativeFunction>(m_natives[index]);
+    auto result = native(values[0], values[1], values[2], values[3], values[4], values[5]);
+    if (ret_bit_width != 0) {
+        *ret = truncate(result, ret_bit_width);
+    }
+}
+
+void Interpreter::execute(const Code &code, std::uint64_t *frame, std::uint64_t *ret) {
+    static void *const dispatch_table[] = {
+        &&add,        &&sub,           &&mul,           &&div,         &&compare_less_than, &&compare_greater_than,
+        &&move,       &&sign_extend,   &&truncate,      &&lea,         &&load,              &&store,
+        &&copy,       &&branch,        &&cond_branch,   &&call,        &&call_indirect,     &&call_native,
+        &&syscall,    &&ret,           &&ret_void,
+    };
+    static_assert(std::size(dispatch_table) == static_cast<std::size_t>(Opcode::RetVoid) + 1);
+
+    const auto *op = code.ops.data();
+    auto take_edge = [&](std::uint32_t index) {
+        const auto &edge = code.edges[index];
+        for (auto i = edge.moves_begin; i < edge.moves_end; i++) {
+            const auto &move = code.moves[i];
+            std::memmove(&frame[move.dst], &frame[move.src], move.count * sizeof(std::uint64_t));
+        }
+        return &code.ops[edge.target];
+    };
+    auto dst = [&] {
+        return op->dst != k_none ? &frame[op->dst] : nullptr;
+    };
+
+#define DISPATCH() goto *dispatch_table[static_cast<std::size_t>(op->opcode)]
+#define NEXT()                                                                                                         \
+    ++op;                                                                                                              \
+    DISPATCH()
+
+    DISPATCH();
+add:
+    frame[op->dst] = truncate(frame[op->a] + frame[op->b], op->imm);
+    NEXT();
+sub:
+    frame[op->dst] = truncate(frame[op->a] - frame[op->b], op->imm);
+    NEXT();
+mul:
+    frame[op->dst] = truncate(frame[op->a] * frame[op->b], op->imm);
+    NEXT();
+div: {
+    auto lhs = sign_extend(frame[op->a], op->imm);
+    auto rhs = sign_extend(frame[op->b], op->imm);
+    if (rhs == 0) {
+        print_error_and_abort("division by zero");
+    }
+    // Dividing the minimum value by -1 overflows, so negate instead which wraps as expected.
+    auto result = rhs == -1 ? 0 - static_cast<std::uint64_t>(lhs) : static_cast<std::uint64_t>(lhs / rhs);
+    frame[op->dst] = truncate(result, op->imm);
+    NEXT();
+}
+compare_less_than:
+    frame[op->dst] = sign_extend(frame[op->a], op->imm) < sign_extend(frame[op->b], op->imm) ? 1 : 0;
+    NEXT();
+compare_greater_than:
+    frame[op->dst] = sign_extend(frame[op->a], op->imm) > sign_extend(frame[op->b], op->imm) ? 1 : 0;
+    NEXT();
+move:
+    std::memmove(&frame[op->dst], &frame[op->a], op->c * sizeof(std::uint64_t));
+    NEXT();
+sign_extend:
+    frame[op->dst] = truncate(static_cast<std::uint64_t>(sign_extend(frame[op->a], op->imm)), op->b);
+    NEXT();
+truncate:
+    frame[op->dst] = truncate(frame[op->a], op->imm);
+    NEXT();
+lea: {
+    auto address = static_cast<std::int64_t>(frame[op->a]) + op->imm;
+    for (auto i = op->b; i < op->b + op->c; i++) {
+        const auto &term = code.lea_terms[i];
+        address += sign_extend(frame[term.slot], term.bit_width) * term.scale;
+    }
+    frame[op->dst] = static_cast<std::uint64_t>(address);
+    NEXT();
+}
+load:
+    frame[op->dst] = 0;
+    std::memcpy(&frame[op->dst], reinterpret_cast<const void *>(frame[op->a]), op->imm);
+    NEXT();
+store:
+    std::memcpy(reinterpret_cast<void *>(frame[op->a]), &frame[op->b], op->imm);
+    NEXT();
+copy:
+    std::memmove(reinterpret_cast<void *>(frame[op->a]), reinterpret_cast<const void *>(frame[op->b]), frame[op->c]);
+    NEXT();
+branch:
+    op = take_edge(op->a);
+    DISPATCH();
+cond_branch:
+    op = take_edge(frame[op->a] != 0 ? op->b : op->c);
+    DISPATCH();
+call:
+    call(op->a, &code.args[op->b], op->c, frame, dst());
+    NEXT();
+call_indirect: {
+    const auto *callee = reinterpret_cast<const ir::Function *>(frame[op->a]);
+    if (callee->prototype()->externed()) {
+        if (op->c > k_max_native_args) {
+            print_error_and_abort("interpreter cannot call extern functions with more than {} arguments",
+                                  k_max_native_args);
+        }
+        const auto *return_type = callee->function_type()->return_type();
+        auto ret_bit_width = ir::Type::base(return_type)->kind() != ir::TypeKind::Void ? bit_width(return_type) : 0;
+        call_native(native_index(callee->name()), &code.args[op->b], op->c, frame, dst(), ret_bit_width);
+        NEXT();
+    }
+    call(function_index(callee), &code.args[op->b], op->c, frame, dst());
+    NEXT();
+}
+call_native:
+    call_native(op->a, &code.args[op->b], op->c, frame, dst(), op->imm);
+    NEXT();
+syscall: {
+    const auto &asm_call = code.asm_calls[op->a];
+    std::array<std::uint64_t, k_syscall_registers.size()> registers{};
+    for (std::size_t i = 0; i < registers.size(); i++) {
+        if (asm_call.inputs[i] != k_none) {
+            registers[i] = frame[asm_call.inputs[i]];
+        }
+    }
+    const SyscallEntry *entry = nullptr;
+    for (const auto &syscall_entry : k_syscalls) {
+        if (syscall_entry.number == registers[0]) {
+            entry = &syscall_entry;
+            break;
+        }
+    }
+    if (entry == nullptr) {
+        print_error_and_abort("interpreter cannot emulate syscall {}", registers[0]);
+    }
+    SyscallArgs args;
+    std::copy(registers.begin() + 1, registers.end(), args.begin());
+    auto result = entry->emulate(args);
+    if (asm_call.output != k_none) {
+        std::memcpy(reinterpret_cast<void *>(frame[asm_call.output]), &result, asm_call.output_size);
+    }
+    NEXT();
+}
+ret:
+    if (ret != nullptr) {
+        std::memcpy(ret, &frame[op->a], op->c * sizeof(std::uint64_t));
+    }
+    return;
+ret_void:
+    return;
+
+#undef NEXT
+#undef DISPATCH
+}
+
+int Interpreter::run() {
+    auto it = m_definitions.find("main");
+    if (it == m_definitions.end()) {
+        print_error_and_abort("no main function");
+    }
+    std::uint64_t ret = 0;
+    call(function_index(it->second), nullptr, 0, nullptr, &ret);
+    return static_cast<int>(ret);
+}
+
+} // namespace
+
+int interpret(const ir::Program *program) {
+    Interpreter interpreter(program);
+    return interpreter.run();
+}
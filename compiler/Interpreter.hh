@@ -0,0 +1,14 @@
+#pragma once
+
+namespace ir {
+
+class Program;
+
+} // namespace ir
+
+/// @brief Executes `main` by interpreting `program` directly, without generating any LLVM IR.
+/// @details Functions are translated lazily, on their first call, into a dense bytecode form which is then executed by
+/// a threaded dispatch loop. Extern functions are resolved in the current process and syscalls made via inline asm are
+/// emulated.
+/// @return The value returned from `main`.
+int interpret(const ir::Program *program);
@@ -1,5 +1,6 @@
 #include <IrGen.hh>
 
+#include <Profile.hh>
 #include <ast/Nodes.hh>
 #include <ir/BasicBlock.hh>
 #include <ir/Constants.hh>
@@ -17,6 +18,7 @@
 #include <string_view>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace {
 
@@ -46,11 +48,24 @@ public:
 };
 
 class IrGen {
+    struct PendingBody {
+        const ast::FunctionDecl *function_decl;
+        const ast::Root *root;
+    };
+
     Box<ir::Program> m_program;
     ir::Function *m_function{nullptr};
     ir::BasicBlock *m_block{nullptr};
+    const ast::Root *m_root{nullptr};
     Stack<Scope> m_scope_stack;
 
+    // Whether function bodies in the current root are only lowered once something calls them.
+    bool m_lazy_bodies{false};
+    std::unordered_map<const ir::Prototype *, ir::Function *> m_definitions;
+    std::unordered_map<std::string, ir::Function *> m_definitions_by_name;
+    std::unordered_map<ir::Function *, PendingBody> m_pending_bodies;
+    std::vector<ir::Function *> m_required_bodies;
+
     enum class DerefState {
         Deref,
         DontDeref,
@@ -68,6 +83,7 @@ public:
     ir::Prototype *create_prototype(const ast::FunctionDecl *, const ir::Type * = nullptr);
     void create_store(const ast::Node *, ir::Value *, ir::Value *);
     ir::Prototype *find_prototype(const ir::Type *, const std::string &);
+    void require_body(const ir::Prototype *);
     ir::Value *get_member_ptr(ir::Value *, int);
     const ir::Type *get_type(const ast::Node *, const std::string &);
     const ir::Type *get_containing_type(const ast::Node *, const ast::Symbol *);
@@ -102,9 +118,12 @@ public:
     void gen_block(const ast::Block *);
 
     void gen_const_decl(const ast::ConstDecl *);
+    void gen_function_body(const ast::FunctionDecl *);
     void gen_function_decl(const ast::FunctionDecl *);
     void gen_type_decl(const ast::TypeDecl *);
     void gen_decl(const ast::Node *);
+    void gen_root(const ast::Root *, bool lazy_bodies);
+    void gen_required_bodies();
 
     Box<ir::Program> program() { return std::move(m_program); }
 };
@@ -152,6 +171,9 @@ ir::Value *IrGen::create_call(const ast::CallExpr *call_expr, ir::Value *callee,
         print_error(call_expr, "no function named '{}' in current context", mangle(call_expr->name()));
         return ir::ConstantNull::get(m_program->invalid_type());
     }
+    if (const auto *prototype = callee->as_or_null<ir::Prototype>()) {
+        require_body(prototype);
+    }
     return m_block->append<ir::CallInst>(callee, std::move(args));
 }
 
@@ -207,6 +229,21 @@ ir::Prototype *IrGen::find_prototype(const ir::Type *containing_type, const std:
     return nullptr;
 }
 
+// Queues the body of the function defining `prototype` to be lowered, if it hasn't been already. Extern declarations
+// are matched with the definition of the same name.
+void IrGen::require_body(const ir::Prototype *prototype) {
+    auto it = m_definitions.find(prototype);
+    ir::Function *function = nullptr;
+    if (it != m_definitions.end()) {
+        function = it->second;
+    } else if (prototype->externed() && m_definitions_by_name.contains(prototype->name())) {
+        function = m_definitions_by_name.at(prototype->name());
+    }
+    if (function != nullptr && m_pending_bodies.contains(function)) {
+        m_required_bodies.push_back(function);
+    }
+}
+
 ir::Value *IrGen::get_member_ptr(ir::Value *ptr, int index) {
     std::vector<ir::Value *> indices;
     indices.reserve(2);
@@ -589,13 +626,9 @@ void IrGen::gen_const_decl(const ast::ConstDecl *const_decl) {
     m_scope_stack.peek().put_var(const_decl->name(), init_val);
 }
 
-void IrGen::gen_function_decl(const ast::FunctionDecl *function_decl) {
-    auto *prototype = create_prototype(function_decl);
+void IrGen::gen_function_body(const ast::FunctionDecl *function_decl) {
+    const auto *prototype = m_function->prototype();
     const auto *function_type = prototype->type()->as<ir::FunctionType>();
-    m_function = m_program->append_function(prototype, mangle(function_decl->name()), function_type);
-    if (prototype->externed()) {
-        return;
-    }
 
     // Create `*this` arg if needed.
     if (function_decl->instance()) {
@@ -638,6 +671,29 @@ void IrGen::gen_function_decl(const ast::FunctionDecl *function_decl) {
     }
 }
 
+void IrGen::gen_function_decl(const ast::FunctionDecl *function_decl) {
+    const auto *containing_type = get_containing_type(function_decl, function_decl->name());
+    auto *prototype = create_prototype(function_decl, containing_type);
+    const auto *function_type = prototype->type()->as<ir::FunctionType>();
+    m_function = m_program->append_function(prototype, mangle(function_decl->name()), function_type);
+    m_function->set_location(m_root->path(), function_decl->line());
+    if (prototype->externed()) {
+        return;
+    }
+    m_definitions.emplace(prototype, m_function);
+    m_definitions_by_name.emplace(m_function->name(), m_function);
+
+    // Functions which may be called through a vtable, or from outside of the program, are always lowered.
+    const auto *struct_type = containing_type != nullptr ? ir::Type::base_as<ir::StructType>(containing_type) : nullptr;
+    bool is_entry_point = m_function->name() == "_start" || m_function->name() == "main" ||
+                          m_function->name() == k_profile_write_function;
+    if (m_lazy_bodies && !is_entry_point && (struct_type == nullptr || struct_type->implementing().empty())) {
+        m_pending_bodies.emplace(m_function, PendingBody{function_decl, m_root});
+        return;
+    }
+    gen_function_body(function_decl);
+}
+
 void IrGen::gen_type_decl(const ast::TypeDecl *type_decl) {
     const auto *type = gen_type(type_decl->type());
     auto name = type_decl->name();
@@ -663,14 +719,42 @@ void IrGen::gen_decl(const ast::Node *decl) {
     }
 }
 
+void IrGen::gen_root(const ast::Root *root, bool lazy_bodies) {
+    m_root = root;
+    m_lazy_bodies = lazy_bodies;
+    for (const auto *decl : root->decls()) {
+        gen_decl(decl);
+    }
+}
+
+// Lowers the bodies of called functions until nothing more is reachable, and then removes the functions whose bodies
+// were never needed. Bodies are lowered after every root has been declared, so they only see global declarations.
+void IrGen::gen_required_bodies() {
+    while (!m_required_bodies.empty()) {
+        m_function = m_required_bodies.back();
+        m_required_bodies.pop_back();
+        auto it = m_pending_bodies.find(m_function);
+        if (it == m_pending_bodies.end()) {
+            continue;
+        }
+        const auto [function_decl, root] = it->second;
+        m_pending_bodies.erase(it);
+        m_root = root;
+        gen_function_body(function_decl);
+    }
+    for (auto [function, pending_body] : m_pending_bodies) {
+        m_program->remove_function(function);
+    }
+    m_pending_bodies.clear();
+}
+
 } // namespace
 
-Box<ir::Program> gen_ir(std::vector<Box<ast::Root>> &&roots) {
+Box<ir::Program> gen_ir(const std::vector<const ast::Root *> &roots, bool lazy_bodies) {
     IrGen gen;
-    for (auto &root : roots) {
-        for (const auto *decl : root->decls()) {
-            gen.gen_decl(decl);
-        }
+    for (std::size_t i = 0; i < roots.size(); i++) {
+        gen.gen_root(roots[i], lazy_bodies && i + 1 != roots.size());
     }
+    gen.gen_required_bodies();
     return gen.program();
 }
@@ -6,4 +6,8 @@
 
 #include <vector>
 
-Box<ir::Program> gen_ir(std::vector<Box<ast::Root>> &&roots);
+/// @brief Lowers the parsed roots to IR.
+/// @details All declarations are lowered, but with `lazy_bodies`, the function bodies of every root apart from the last
+/// (the main file) are only lowered once they are reachable from a lowered body, an entry point or a vtable. Bodies
+/// which are never reached don't appear in the resulting program.
+Box<ir::Program> gen_ir(const std::vector<const ast::Root *> &roots, bool lazy_bodies = true);
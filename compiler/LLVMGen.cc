@@ -1,44 +1,87 @@
 #include <LLVMGen.hh>
 
+#include <FunctionAttrs.hh>
+#include <Profile.hh>
 #include <ir/BasicBlock.hh>
 #include <ir/Constants.hh>
+#include <ir/DataLayout.hh>
 #include <ir/Function.hh>
 #include <ir/Instructions.hh>
 #include <ir/Program.hh>
 #include <ir/Types.hh>
 #include <support/Assert.hh>
 
+#include <llvm/IR/DIBuilder.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/InlineAsm.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace {
 
+llvm::Align llvm_align(const ir::Type *type) {
+    return llvm::Align(ir::align_of(type));
+}
+
+// Returns the alignment of the memory `ptr` points to, which is unknown for pointers to traits and void.
+llvm::Align pointee_align(const ir::Value *ptr) {
+    const auto *pointer_type = ir::Type::base_as<ir::PointerType>(ptr->type());
+    return pointer_type != nullptr ? llvm_align(pointer_type->pointee_type()) : llvm::Align(1);
+}
+
 class LLVMGen {
     llvm::LLVMContext *const m_llvm_context;
+    const LLVMGenOptions &m_options;
 
     std::unique_ptr<llvm::Module> m_llvm_module;
     llvm::Function *m_llvm_function{nullptr};
     llvm::BasicBlock *m_llvm_block{nullptr};
     llvm::IRBuilder<> m_llvm_builder;
-
+    llvm::MDBuilder m_md_builder;
+    llvm::MDNode *m_tbaa_root;
+    llvm::MDNode *m_tbaa_char;
+
+    // Only used when generating debug info.
+    std::unique_ptr<llvm::DIBuilder> m_di_builder;
+    llvm::DISubroutineType *m_di_function_type{nullptr};
+    llvm::DISubprogram *m_di_subprogram{nullptr};
+    std::unordered_map<std::string, llvm::DIFile *> m_di_files;
+    int m_line{0};
+
+    std::unordered_map<const ir::Function *, FunctionAttrs> m_function_attrs;
     std::unordered_map<const ir::Argument *, llvm::Argument *> m_arg_map;
     std::unordered_map<const ir::BasicBlock *, llvm::BasicBlock *> m_block_map;
+    std::unordered_map<const ir::Type *, llvm::MDNode *> m_tbaa_type_map;
+    std::unordered_map<const ir::Type *, llvm::Type *> m_type_map;
     std::unordered_map<const ir::Value *, llvm::Value *> m_value_map;
 
 public:
-    explicit LLVMGen(llvm::LLVMContext *llvm_context);
+    LLVMGen(llvm::LLVMContext *llvm_context, const LLVMGenOptions &options);
+
+    llvm::DIFile *di_file(const std::string &path);
+    void set_debug_line(int line);
 
-    llvm::ArrayType *llvm_array_type(const ir::ArrayType *);
-    llvm::FunctionType *llvm_function_type(const ir::FunctionType *);
-    llvm::StructType *llvm_struct_type(const ir::StructType *);
     llvm::Type *llvm_type(const ir::Type *);
     llvm::Value *llvm_value(const ir::Value *);
 
+    llvm::ArrayType *gen_array_type(const ir::ArrayType *);
+    llvm::FunctionType *gen_function_type(const ir::FunctionType *);
+    llvm::StructType *gen_struct_type(const ir::StructType *);
+    llvm::Type *gen_type(const ir::Type *);
+
+    llvm::MDNode *tbaa_type(const ir::Type *);
+    llvm::MDNode *tbaa_access_tag(const ir::Value *ptr, const ir::Type *type);
+
     llvm::Value *gen_constant_array(const ir::ConstantArray *);
     llvm::Value *gen_constant_int(const ir::ConstantInt *);
     llvm::Value *gen_constant_string(const ir::ConstantString *);
@@ -59,26 +102,56 @@ public:
 
     llvm::Value *gen_argument(const ir::Argument *);
     llvm::Value *gen_constant(const ir::Constant *);
+    void gen_function_attrs(const ir::Function *);
     llvm::Value *gen_function(const ir::Function *);
     llvm::Value *gen_global(const ir::GlobalVariable *);
     llvm::Value *gen_instruction(const ir::Instruction *);
     llvm::Value *gen_value(const ir::Value *);
 
     void gen_block(const ir::BasicBlock *);
+    void gen_debug_info(const ir::Program *);
     void gen_program(const ir::Program *);
 
     std::unique_ptr<llvm::Module> module() { return std::move(m_llvm_module); }
 };
 
-LLVMGen::LLVMGen(llvm::LLVMContext *llvm_context) : m_llvm_context(llvm_context), m_llvm_builder(*llvm_context) {
+LLVMGen::LLVMGen(llvm::LLVMContext *llvm_context, const LLVMGenOptions &options)
+    : m_llvm_context(llvm_context), m_options(options), m_llvm_builder(*llvm_context), m_md_builder(*llvm_context) {
     m_llvm_module = std::make_unique<llvm::Module>("main", *m_llvm_context);
+    // As in C, bytes may alias anything, which is what allows trait objects and heap memory to be accessed through
+    // byte pointers.
+    m_tbaa_root = m_md_builder.createTBAARoot("kodo TBAA");
+    m_tbaa_char = m_md_builder.createTBAAScalarTypeNode("i8", m_tbaa_root);
+}
+
+llvm::DIFile *LLVMGen::di_file(const std::string &path) {
+    if (auto it = m_di_files.find(path); it != m_di_files.end()) {
+        return it->second;
+    }
+    llvm::SmallString<128> absolute_path(path);
+    llvm::sys::fs::make_absolute(absolute_path);
+    auto *file = m_di_builder->createFile(llvm::sys::path::filename(absolute_path),
+                                          llvm::sys::path::parent_path(absolute_path));
+    return m_di_files.emplace(path, file).first->second;
+}
+
+// Sets the line of the instructions generated next. Instructions without a line of their own, such as implicit returns,
+// are attributed to the line before them.
+void LLVMGen::set_debug_line(int line) {
+    if (m_di_subprogram == nullptr) {
+        return;
+    }
+    if (line > 0) {
+        m_line = line;
+    }
+    m_llvm_builder.SetCurrentDebugLocation(llvm::DILocation::get(*m_llvm_context, m_line, 0, m_di_subprogram));
 }
 
-llvm::ArrayType *LLVMGen::llvm_array_type(const ir::ArrayType *array_type) {
+llvm::ArrayType *LLVMGen::gen_array_type(const ir::ArrayType *array_type) {
     return llvm::ArrayType::get(llvm_type(array_type->element_type()), array_type->length());
 }
 
-llvm::FunctionType *LLVMGen::llvm_function_type(const ir::FunctionType *function_type) {
+llvm::FunctionType *LLVMGen::gen_function_type(const ir::FunctionType *function_type) {
     std::vector<llvm::Type *> params;
     params.reserve(function_type->params().size());
     for (const auto *param : function_type->params()) {
@@ -87,7 +160,7 @@ llvm::FunctionType *LLVMGen::llvm_function_type(const ir::FunctionType *function
     return llvm::FunctionType::get(llvm_type(function_type->return_type()), params, false);
 }
 
-llvm::StructType *LLVMGen::llvm_struct_type(const ir::StructType *struct_type) {
+llvm::StructType *LLVMGen::gen_struct_type(const ir::StructType *struct_type) {
     std::vector<llvm::Type *> fields;
     fields.reserve(struct_type->fields().size());
     for (const auto &field : struct_type->fields()) {
@@ -97,21 +170,36 @@ llvm::StructType *LLVMGen::llvm_struct_type(const ir::StructType *struct_type) {
 }
 
 llvm::Type *LLVMGen::llvm_type(const ir::Type *type) {
+    if (auto it = m_type_map.find(type); it != m_type_map.end()) {
+        return it->second;
+    }
+    auto *llvm_type = gen_type(type);
+    m_type_map.emplace(type, llvm_type);
+    return llvm_type;
+}
+
+llvm::Type *LLVMGen::gen_type(const ir::Type *type) {
     switch (type->kind()) {
     case ir::TypeKind::Alias:
         return llvm_type(type->as<ir::AliasType>()->aliased());
     case ir::TypeKind::Array:
-        return llvm_array_type(type->as<ir::ArrayType>());
+        return gen_array_type(type->as<ir::ArrayType>());
     case ir::TypeKind::Bool:
         return llvm::Type::getInt1Ty(*m_llvm_context);
     case ir::TypeKind::Function:
-        return llvm_function_type(type->as<ir::FunctionType>());
+        return gen_function_type(type->as<ir::FunctionType>());
     case ir::TypeKind::Int:
         return llvm::Type::getIntNTy(*m_llvm_context, type->as<ir::IntType>()->bit_width());
-    case ir::TypeKind::Pointer:
-        return llvm::PointerType::get(llvm_type(type->as<ir::PointerType>()->pointee_type()), 0);
+    case ir::TypeKind::Pointer: {
+        // LLVM doesn't allow pointers to void, so use i8 as the pointee instead.
+        auto *pointee_type = llvm_type(type->as<ir::PointerType>()->pointee_type());
+        if (pointee_type->isVoidTy()) {
+            pointee_type = llvm::Type::getInt8Ty(*m_llvm_context);
+        }
+        return llvm::PointerType::get(pointee_type, 0);
+    }
     case ir::TypeKind::Struct:
-        return llvm_struct_type(type->as<ir::StructType>());
+        return gen_struct_type(type->as<ir::StructType>());
     case ir::TypeKind::Trait:
     case ir::TypeKind::Void:
         return llvm::Type::getVoidTy(*m_llvm_context);
@@ -121,24 +209,85 @@ llvm::Type *LLVMGen::llvm_type(const ir::Type *type) {
 }
 
 llvm::Value *LLVMGen::llvm_value(const ir::Value *value) {
-    if (!m_value_map.contains(value)) {
-        m_value_map.emplace(value, gen_value(value));
+    if (auto it = m_value_map.find(value); it != m_value_map.end()) {
+        return it->second;
     }
-    auto *llvm_value = m_value_map.at(value);
+    // Values are named once when they're first generated, rather than on every use.
+    auto *llvm_value = gen_value(value);
     if (value->has_name()) {
         llvm_value->setName(value->name());
     }
-    return llvm_value;
+    return m_value_map.emplace(value, llvm_value).first->second;
+}
+
+// Returns the TBAA type node for `type`, or null if it has none. Signedness doesn't matter for aliasing, and all
+// pointers may alias each other since pointers are reinterpreted when making trait objects.
+llvm::MDNode *LLVMGen::tbaa_type(const ir::Type *type) {
+    type = ir::Type::base(type);
+    if (auto it = m_tbaa_type_map.find(type); it != m_tbaa_type_map.end()) {
+        return it->second;
+    }
+    llvm::MDNode *node = nullptr;
+    if (type->is<ir::BoolType>()) {
+        node = m_md_builder.createTBAAScalarTypeNode("bool", m_tbaa_char);
+    } else if (const auto *int_type = type->as_or_null<ir::IntType>()) {
+        node = int_type->bit_width() == 8
+                   ? m_tbaa_char
+                   : m_md_builder.createTBAAScalarTypeNode("i" + std::to_string(int_type->bit_width()), m_tbaa_char);
+    } else if (type->is<ir::PointerType>()) {
+        node = m_md_builder.createTBAAScalarTypeNode("pointer", m_tbaa_char);
+    } else if (const auto *struct_type = type->as_or_null<ir::StructType>()) {
+        std::vector<std::pair<llvm::MDNode *, std::uint64_t>> fields;
+        for (std::size_t i = 0; i < struct_type->fields().size(); i++) {
+            if (auto *field_node = tbaa_type(struct_type->fields()[i].type())) {
+                fields.emplace_back(field_node, ir::field_offset(struct_type, i));
+            }
+        }
+        node = m_md_builder.createTBAAStructTypeNode(struct_type->to_string(), fields);
+    }
+    m_tbaa_type_map.emplace(type, node);
+    return node;
+}
+
+// Returns the TBAA access tag for a scalar access of `type` through `ptr`. Struct field addresses are followed back to
+// the outermost struct so that accesses to different fields of the same struct type are known not to alias.
+llvm::MDNode *LLVMGen::tbaa_access_tag(const ir::Value *ptr, const ir::Type *type) {
+    auto *access_type = tbaa_type(type);
+    if (access_type == nullptr || ir::Type::base(type)->is<ir::StructType>()) {
+        return nullptr;
+    }
+    auto *base_type = access_type;
+    std::uint64_t offset = 0;
+    while (const auto *inst = ptr->as_or_null<ir::Instruction>()) {
+        const auto *lea = inst->as_or_null<ir::LeaInst>();
+        if (lea == nullptr || lea->indices().size() != 2) {
+            break;
+        }
+        // Globals are used by address but typed by their contents.
+        const auto *pointer_type = ir::Type::base_as<ir::PointerType>(lea->ptr()->type());
+        if (pointer_type == nullptr) {
+            break;
+        }
+        const auto *struct_type = ir::Type::base_as<ir::StructType>(pointer_type->pointee_type());
+        if (struct_type == nullptr) {
+            break;
+        }
+        const auto *index = lea->indices()[1]->as<ir::Constant>()->as<ir::ConstantInt>();
+        offset += ir::field_offset(struct_type, index->value());
+        base_type = tbaa_type(struct_type);
+        ptr = lea->ptr();
+    }
+    return m_md_builder.createTBAAStructTagNode(base_type, access_type, offset);
 }
 
 llvm::Value *LLVMGen::gen_constant_array(const ir::ConstantArray *constant_array) {
-    auto *llvm_type = llvm_array_type(constant_array->type()->as<ir::ArrayType>());
+    auto *array_type = llvm::cast<llvm::ArrayType>(llvm_type(constant_array->type()));
     std::vector<llvm::Constant *> llvm_array_elems;
     llvm_array_elems.reserve(constant_array->elems().size());
     for (auto *elem : constant_array->elems()) {
         llvm_array_elems.push_back(llvm::cast<llvm::Constant>(llvm_value(elem)));
     }
-    return llvm::ConstantArray::get(llvm_type, llvm_array_elems);
+    return llvm::ConstantArray::get(array_type, llvm_array_elems);
 }
 
 llvm::Value *LLVMGen::gen_constant_int(const ir::ConstantInt *constant_int) {
@@ -172,7 +321,15 @@ llvm::Value *LLVMGen::gen_call(const ir::CallInst *call) {
         args.push_back(llvm_value(arg));
     }
     auto *callee = llvm_value(call->callee());
-    return m_llvm_builder.CreateCall(llvm_function_type(call->callee_function_type()), callee, args);
+    auto *function_type = llvm::cast<llvm::FunctionType>(llvm_type(call->callee_function_type()));
+    auto *llvm_call = m_llvm_builder.CreateCall(function_type, callee, args);
+    // Calls which were never reached in a function which was are on a cold path.
+    const auto *function = call->parent()->parent();
+    if (m_options.profile != nullptr && m_options.profile->call_count(call) == 0 &&
+        m_options.profile->block_count(function->entry()) != 0) {
+        llvm_call->addFnAttr(llvm::Attribute::Cold);
+    }
+    return llvm_call;
 }
 
 llvm::Value *LLVMGen::gen_cast(const ir::CastInst *cast) {
@@ -207,6 +364,18 @@ llvm::Value *LLVMGen::gen_inline_asm(const ir::InlineAsmInst *inline_asm) {
     std::string llvm_str;
     bool first = true;
 
+    // Build outputs, which must come before inputs in the constraint string.
+    std::vector<llvm::Type *> ret_types;
+    ret_types.reserve(inline_asm->outputs().size());
+    for (const auto &[output, value] : inline_asm->outputs()) {
+        if (!first) {
+            llvm_str += ',';
+        }
+        first = false;
+        llvm_str += "={" + output + '}';
+        ret_types.push_back(llvm_type(value->as<ir::LocalVar>()->var_type()));
+    }
+
     // Build inputs.
     std::vector<llvm::Value *> args;
     std::vector<llvm::Type *> arg_types;
@@ -222,18 +391,6 @@ llvm::Value *LLVMGen::gen_inline_asm(const ir::InlineAsmInst *inline_asm) {
         arg_types.push_back(llvm_type(value->type()));
     }
 
-    // Build outputs.
-    std::vector<llvm::Type *> ret_types;
-    ret_types.reserve(inline_asm->outputs().size());
-    for (const auto &[output, value] : inline_asm->outputs()) {
-        if (!first) {
-            llvm_str += ',';
-        }
-        first = false;
-        llvm_str += "={" + output + '}';
-        ret_types.push_back(llvm_type(value->as<ir::LocalVar>()->var_type()));
-    }
-
     // Build clobbers.
     for (const auto &clobber : inline_asm->clobbers()) {
         if (!first) {
@@ -243,19 +400,27 @@ llvm::Value *LLVMGen::gen_inline_asm(const ir::InlineAsmInst *inline_asm) {
         llvm_str += "~{" + clobber + '}';
     }
 
+    // A single output is returned directly, since a struct return type is only valid for multiple outputs.
     auto *ret_type = llvm::Type::getVoidTy(*m_llvm_context);
-    if (!ret_types.empty()) {
+    if (ret_types.size() == 1) {
+        ret_type = ret_types[0];
+    } else if (!ret_types.empty()) {
         ret_type = llvm::StructType::get(*m_llvm_context, ret_types, false);
     }
     auto *type = llvm::FunctionType::get(ret_type, arg_types, false);
     auto *llvm_asm =
         llvm::InlineAsm::get(type, inline_asm->instruction(), llvm_str, true, true, llvm::InlineAsm::AD_Intel);
     auto *call = m_llvm_builder.CreateCall(llvm_asm, args);
-    for (int i = 0; const auto &[output, value] : inline_asm->outputs()) {
+    if (ret_types.size() == 1) {
+        const auto *output = inline_asm->outputs()[0].second;
+        m_llvm_builder.CreateAlignedStore(call, llvm_value(output), pointee_align(output));
+        return call;
+    }
+    for (unsigned int i = 0; const auto &[output, value] : inline_asm->outputs()) {
         std::vector<unsigned int> indices;
-        indices.push_back(i);
+        indices.push_back(i++);
         auto *extract = m_llvm_builder.CreateExtractValue(call, indices);
-        m_llvm_builder.CreateStore(extract, llvm_value(value));
+        m_llvm_builder.CreateAlignedStore(extract, llvm_value(value), pointee_align(value));
     }
     return call;
 }
@@ -270,11 +435,16 @@ llvm::Value *LLVMGen::gen_lea(const ir::LeaInst *lea) {
     if (indices.size() == 1) {
         ptr = m_llvm_builder.CreateBitCast(ptr, llvm_type(lea->type()));
     }
-    return m_llvm_builder.CreateInBoundsGEP(ptr, indices);
+    return m_llvm_builder.CreateInBoundsGEP(ptr->getType()->getPointerElementType(), ptr, indices);
 }
 
 llvm::Value *LLVMGen::gen_load(const ir::LoadInst *load) {
-    return m_llvm_builder.CreateLoad(llvm_value(load->ptr()));
+    auto *llvm_load =
+        m_llvm_builder.CreateAlignedLoad(llvm_type(load->type()), llvm_value(load->ptr()), llvm_align(load->type()));
+    if (auto *tbaa = tbaa_access_tag(load->ptr(), load->type())) {
+        llvm_load->setMetadata(llvm::LLVMContext::MD_tbaa, tbaa);
+    }
+    return llvm_load;
 }
 
 llvm::Value *LLVMGen::gen_phi(const ir::PhiInst *phi) {
@@ -293,18 +463,30 @@ void LLVMGen::gen_cond_branch(const ir::CondBranchInst *cond_branch) {
     auto *cond = llvm_value(cond_branch->cond());
     auto *true_dst = m_block_map.at(cond_branch->true_dst());
     auto *false_dst = m_block_map.at(cond_branch->false_dst());
-    m_llvm_builder.CreateCondBr(cond, true_dst, false_dst);
+    auto *llvm_branch = m_llvm_builder.CreateCondBr(cond, true_dst, false_dst);
+    if (m_options.profile != nullptr) {
+        // Branch weights are 32-bit, so scale down large counts.
+        auto [true_count, false_count] = m_options.profile->branch_weights(cond_branch);
+        auto scale = std::max(true_count, false_count) / std::numeric_limits<std::uint32_t>::max() + 1;
+        auto *weights = m_md_builder.createBranchWeights(static_cast<std::uint32_t>(true_count / scale),
+                                                         static_cast<std::uint32_t>(false_count / scale));
+        llvm_branch->setMetadata(llvm::LLVMContext::MD_prof, weights);
+    }
 }
 
 void LLVMGen::gen_copy(const ir::CopyInst *copy) {
     auto *dst = llvm_value(copy->dst());
     auto *src = llvm_value(copy->src());
     auto *len = llvm_value(copy->len());
-    m_llvm_builder.CreateMemCpy(dst, llvm::MaybeAlign(), src, llvm::MaybeAlign(), len);
+    m_llvm_builder.CreateMemCpy(dst, pointee_align(copy->dst()), src, pointee_align(copy->src()), len);
 }
 
 void LLVMGen::gen_store(const ir::StoreInst *store) {
-    m_llvm_builder.CreateStore(llvm_value(store->val()), llvm_value(store->ptr()));
+    auto *llvm_store = m_llvm_builder.CreateAlignedStore(llvm_value(store->val()), llvm_value(store->ptr()),
+                                                         llvm_align(store->val()->type()));
+    if (auto *tbaa = tbaa_access_tag(store->ptr(), store->val()->type())) {
+        llvm_store->setMetadata(llvm::LLVMContext::MD_tbaa, tbaa);
+    }
 }
 
 void LLVMGen::gen_ret(const ir::RetInst *ret) {
@@ -336,18 +518,63 @@ llvm::Value *LLVMGen::gen_constant(const ir::Constant *constant) {
     }
 }
 
+void LLVMGen::gen_function_attrs(const ir::Function *function) {
+    // There are no exceptions in kodo.
+    m_llvm_function->addFnAttr(llvm::Attribute::NoUnwind);
+    if (m_options.frame_pointers) {
+        m_llvm_function->addFnAttr("frame-pointer", "all");
+    }
+    if (!m_options.target_cpu.empty()) {
+        m_llvm_function->addFnAttr("target-cpu", m_options.target_cpu);
+    }
+    if (!m_options.target_features.empty()) {
+        m_llvm_function->addFnAttr("target-features", m_options.target_features);
+    }
+    auto it = m_function_attrs.find(function);
+    if (it == m_function_attrs.end()) {
+        return;
+    }
+    const auto &attrs = it->second;
+    if (attrs.memory == MemoryEffect::None) {
+        m_llvm_function->addFnAttr(llvm::Attribute::ReadNone);
+    } else if (attrs.memory == MemoryEffect::ReadOnly) {
+        m_llvm_function->addFnAttr(llvm::Attribute::ReadOnly);
+    }
+    if (attrs.will_return) {
+        m_llvm_function->addFnAttr(llvm::Attribute::WillReturn);
+    }
+    for (unsigned i = 0; i < attrs.readonly_args.size(); i++) {
+        if (attrs.readonly_args[i]) {
+            m_llvm_function->addParamAttr(i, llvm::Attribute::ReadOnly);
+        }
+        if (attrs.noalias_args[i]) {
+            m_llvm_function->addParamAttr(i, llvm::Attribute::NoAlias);
+        }
+    }
+
+    // `this` always points to a whole struct, since there are no null pointers.
+    if (function->prototype()->externed() || function->args().empty()) {
+        return;
+    }
+    const auto *this_arg = *function->args().begin();
+    const auto *this_type = ir::Type::base_as<ir::PointerType>(this_arg->type());
+    if (!this_arg->has_name() || this_arg->name() != "this" || this_type == nullptr) {
+        return;
+    }
+    if (const auto *struct_type = ir::Type::base_as<ir::StructType>(this_type->pointee_type())) {
+        m_llvm_function->addParamAttr(0, llvm::Attribute::NonNull);
+        m_llvm_function->addDereferenceableParamAttr(0, ir::size_of(struct_type));
+    }
+}
+
 llvm::Value *LLVMGen::gen_function(const ir::Function *function) {
     m_llvm_function = m_llvm_module->getFunction(function->name());
     if (m_llvm_function == nullptr) {
-        std::vector<llvm::Type *> llvm_params;
-        for (const auto *param : function->prototype()->params()) {
-            llvm_params.push_back(llvm_type(param));
-        }
-
-        auto *function_type = llvm_function_type(function->function_type());
+        auto *function_type = llvm::cast<llvm::FunctionType>(llvm_type(function->function_type()));
         m_llvm_function =
             llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, function->name(), *m_llvm_module);
     }
+    gen_function_attrs(function);
 
     // If the function has no blocks, return early.
     if (function->prototype()->externed()) {
@@ -355,6 +582,23 @@ llvm::Value *LLVMGen::gen_function(const ir::Function *function) {
         return m_llvm_function;
     }
 
+    if (m_di_builder) {
+        auto *file = di_file(function->file());
+        m_di_subprogram = m_di_builder->createFunction(file, function->name(), function->name(), file,
+                                                       function->line(), m_di_function_type, function->line(),
+                                                       llvm::DINode::FlagPrototyped,
+                                                       llvm::DISubprogram::SPFlagDefinition);
+        m_llvm_function->setSubprogram(m_di_subprogram);
+        set_debug_line(function->line());
+    }
+    if (m_options.profile != nullptr) {
+        auto entry_count = m_options.profile->block_count(function->entry());
+        m_llvm_function->setEntryCount(llvm::Function::ProfileCount(entry_count, llvm::Function::PCT_Real));
+        if (entry_count == 0) {
+            m_llvm_function->addFnAttr(llvm::Attribute::Cold);
+        }
+    }
+
     m_llvm_block = llvm::BasicBlock::Create(*m_llvm_context, "vars", m_llvm_function);
     m_llvm_builder.SetInsertPoint(m_llvm_block);
     for (const auto *block : *function) {
@@ -367,6 +611,10 @@ llvm::Value *LLVMGen::gen_function(const ir::Function *function) {
     }
     for (const auto *var : function->vars()) {
         auto *alloca = m_llvm_builder.CreateAlloca(llvm_type(var->var_type()));
+        alloca->setAlignment(llvm_align(var->var_type()));
+        if (var->has_name()) {
+            alloca->setName(var->name());
+        }
         m_value_map.emplace(var, alloca);
     }
     for (const auto *block : *function) {
@@ -377,9 +625,17 @@ llvm::Value *LLVMGen::gen_function(const ir::Function *function) {
 
 llvm::Value *LLVMGen::gen_global(const ir::GlobalVariable *global) {
     auto *llvm_initialiser = llvm::cast<llvm::Constant>(llvm_value(global->initialiser()));
-    auto *llvm_global = new llvm::GlobalVariable(*m_llvm_module, llvm_initialiser->getType(), true,
-                                                 llvm::GlobalValue::PrivateLinkage, llvm_initialiser, global->name());
-    llvm_global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    auto *llvm_global =
+        new llvm::GlobalVariable(*m_llvm_module, llvm_initialiser->getType(), !global->is_mutable(),
+                                 llvm::GlobalValue::PrivateLinkage, llvm_initialiser, global->name());
+    llvm_global->setAlignment(llvm_align(global->initialiser()->type()));
+    if (global->is_mutable()) {
+        // Mutable globals must have a single definition, even when the module is split up for parallel codegen.
+        llvm_global->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        llvm_global->setVisibility(llvm::GlobalValue::HiddenVisibility);
+    } else {
+        llvm_global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    }
     return llvm_global;
 }
 
@@ -445,20 +701,48 @@ void LLVMGen::gen_block(const ir::BasicBlock *block) {
     }
     m_llvm_builder.SetInsertPoint(m_llvm_block = new_block);
     for (const auto *inst : *block) {
+        set_debug_line(inst->line());
         llvm_value(inst);
     }
 }
 
+void LLVMGen::gen_debug_info(const ir::Program *program) {
+    // Name the compile unit after the file defining main, which is the file kodoc was invoked on.
+    const ir::Function *main_function = nullptr;
+    for (const auto *function : *program) {
+        if (!function->prototype()->externed() && (main_function == nullptr || function->name() == "main")) {
+            main_function = function;
+        }
+    }
+    if (main_function == nullptr) {
+        return;
+    }
+    m_di_builder = std::make_unique<llvm::DIBuilder>(*m_llvm_module);
+    m_di_builder->createCompileUnit(llvm::dwarf::DW_LANG_C, di_file(main_function->file()), "kodoc", false, "", 0, "",
+                                    llvm::DICompileUnit::LineTablesOnly);
+    m_di_function_type = m_di_builder->createSubroutineType(m_di_builder->getOrCreateTypeArray({}));
+    m_llvm_module->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+    m_llvm_module->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+}
+
 void LLVMGen::gen_program(const ir::Program *program) {
+    m_function_attrs = infer_function_attrs(program);
+    if (m_options.debug_info) {
+        gen_debug_info(program);
+    }
     for (auto *function : *program) {
         llvm_value(function);
     }
+    if (m_di_builder) {
+        m_di_builder->finalize();
+    }
 }
 
 } // namespace
 
-std::unique_ptr<llvm::Module> gen_llvm(const ir::Program *program, llvm::LLVMContext *llvm_context) {
-    LLVMGen gen(llvm_context);
+std::unique_ptr<llvm::Module> gen_llvm(const ir::Program *program, llvm::LLVMContext *llvm_context,
+                                       const LLVMGenOptions &options) {
+    LLVMGen gen(llvm_context, options);
     gen.gen_program(program);
     return gen.module();
 }
@@ -4,6 +4,9 @@
 #include <llvm/IR/Module.h>
 
 #include <memory>
+#include <string>
+
+class Profile;
 
 namespace ir {
 
@@ -11,4 +14,17 @@ class Program;
 
 } // namespace ir
 
-std::unique_ptr<llvm::Module> gen_llvm(const ir::Program *program, llvm::LLVMContext *llvm_context);
+struct LLVMGenOptions {
+    // Emit DWARF line tables.
+    bool debug_info{false};
+    // Keep the frame pointer in every function, so that profilers can walk the stack.
+    bool frame_pointers{false};
+    // The CPU and features, such as "+avx2", to generate code for. Left up to the target machine when empty.
+    std::string target_cpu;
+    std::string target_features;
+    // Execution counts used to annotate functions with entry counts and branches with weights.
+    const Profile *profile{nullptr};
+};
+
+std::unique_ptr<llvm::Module> gen_llvm(const ir::Program *program, llvm::LLVMContext *llvm_context,
+                                       const LLVMGenOptions &options = {});
@@ -0,0 +1,95 @@
+#include <ObjectCache.hh>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/SHA1.h>
+
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+// Hashes a string along with its length so that adjacent components can't run into each other.
+void update(llvm::SHA1 &hasher, const std::string &str) {
+    hasher.update(std::to_string(str.size()));
+    hasher.update(":");
+    hasher.update(str);
+}
+
+// Identifies the running compiler binary, so that rebuilding the compiler invalidates its cached objects.
+std::string compiler_identity() {
+    std::string identity = LLVM_VERSION_STRING;
+    auto path = llvm::sys::fs::getMainExecutable(nullptr, reinterpret_cast<void *>(&compiler_identity));
+    llvm::sys::fs::file_status status;
+    if (!llvm::sys::fs::status(path, status)) {
+        identity += ':' + std::to_string(status.getSize());
+        identity += ':' + std::to_string(status.getLastModificationTime().time_since_epoch().count());
+    }
+    return identity;
+}
+
+} // namespace
+
+std::string ObjectCache::compute_key(const std::vector<std::string> &sources, const std::string &target,
+                                     const std::string &options) {
+    llvm::SHA1 hasher;
+    update(hasher, compiler_identity());
+    update(hasher, target);
+    update(hasher, options);
+    for (const auto &source : sources) {
+        update(hasher, source);
+    }
+    return llvm::toHex(hasher.final(), true);
+}
+
+ObjectCache::ObjectCache(std::filesystem::path dir, std::string key) : m_dir(std::move(dir)), m_key(std::move(key)) {
+    std::ifstream stats(stats_path());
+    stats >> m_hits >> m_misses;
+}
+
+std::filesystem::path ObjectCache::object_path() const {
+    return m_dir / (m_key + ".o");
+}
+
+std::filesystem::path ObjectCache::stats_path() const {
+    return m_dir / "stats";
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCache::lookup() {
+    auto buffer = llvm::MemoryBuffer::getFile(object_path().string());
+    auto &count = buffer ? m_hits : m_misses;
+    count++;
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+    std::ofstream(stats_path()) << m_hits << ' ' << m_misses << '\n';
+    return buffer ? std::move(*buffer) : nullptr;
+}
+
+void ObjectCache::store(llvm::MemoryBufferRef object) {
+    // Write to a temporary file first so that a concurrent lookup never sees a partially written object.
+    std::error_code ec;
+    std::filesystem::create_directories(m_dir, ec);
+    auto temp_path = object_path();
+    temp_path += ".tmp" + std::to_string(llvm::sys::Process::getProcessId());
+    {
+        std::ofstream stream(temp_path, std::ios::binary);
+        stream.write(object.getBufferStart(), static_cast<std::streamsize>(object.getBufferSize()));
+        if (!stream) {
+            std::filesystem::remove(temp_path, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(temp_path, object_path(), ec);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCache::getObject(const llvm::Module *) {
+    // Lookups are done up front by the driver, before the module is even generated.
+    return nullptr;
+}
+
+void ObjectCache::notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef object) {
+    store(object);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// @brief A persistent, content addressed cache of compiled objects.
+/// @details Objects are keyed by a hash of everything that affects code generation: the source files, the compiler
+/// binary, the target and any options. A cumulative count of hits and misses is kept alongside the objects.
+class ObjectCache : public llvm::ObjectCache {
+    const std::filesystem::path m_dir;
+    const std::string m_key;
+    std::size_t m_hits{0};
+    std::size_t m_misses{0};
+
+    std::filesystem::path object_path() const;
+    std::filesystem::path stats_path() const;
+
+public:
+    static std::string compute_key(const std::vector<std::string> &sources, const std::string &target,
+                                   const std::string &options);
+
+    ObjectCache(std::filesystem::path dir, std::string key);
+
+    /// @brief Returns the cached object, or null on a miss, and records the hit or miss.
+    std::unique_ptr<llvm::MemoryBuffer> lookup();
+    void store(llvm::MemoryBufferRef object);
+
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *) override;
+    void notifyObjectCompiled(const llvm::Module *, llvm::MemoryBufferRef object) override;
+
+    const std::string &key() const { return m_key; }
+    std::size_t hits() const { return m_hits; }
+    std::size_t misses() const { return m_misses; }
+};
@@ -0,0 +1,137 @@
+#include <ObjectEmitter.hh>
+
+#include <support/Assert.hh>
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/SmallVectorMemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+
+// Roughly how much code goes into each partition, and a limit on the number of objects emitted for large programs.
+constexpr std::size_t k_instructions_per_partition = 2000;
+constexpr std::size_t k_max_partitions = 16;
+
+// Assigns the defined functions to partitions, keeping them in module order and balancing by instruction count.
+std::unordered_map<const llvm::GlobalValue *, std::size_t> partition_functions(const llvm::Module &module,
+                                                                                std::size_t &partition_count) {
+    std::size_t total_size = 0;
+    for (const auto &function : module) {
+        total_size += function.getInstructionCount();
+    }
+    partition_count = std::clamp<std::size_t>(total_size / k_instructions_per_partition, 1, k_max_partitions);
+
+    std::unordered_map<const llvm::GlobalValue *, std::size_t> partitions;
+    std::size_t partition = 0;
+    std::size_t size = 0;
+    for (const auto &function : module) {
+        if (function.isDeclaration()) {
+            continue;
+        }
+        // Functions are referenced by name from other partitions.
+        ENSURE(!function.hasLocalLinkage());
+        partitions.emplace(&function, partition);
+        size += function.getInstructionCount();
+        if (partition + 1 < partition_count && size >= (partition + 1) * total_size / partition_count) {
+            partition++;
+        }
+    }
+    // Mutable globals are defined once, in the first partition.
+    for (const auto &global : module.globals()) {
+        if (!global.isConstant()) {
+            ENSURE(!global.hasLocalLinkage());
+            partitions.emplace(&global, 0);
+        }
+    }
+    return partitions;
+}
+
+// Clones the part of `module` for which `should_define` returns true, along with the constant globals it uses.
+std::unique_ptr<llvm::Module> clone_partition(const llvm::Module &module,
+                                              const std::function<bool(const llvm::GlobalValue &)> &should_define) {
+    llvm::ValueToValueMapTy value_map;
+    auto clone = llvm::CloneModule(module, value_map, [&](const llvm::GlobalValue *global) {
+        if (!llvm::isa<llvm::Function>(global) && llvm::cast<llvm::GlobalVariable>(global)->isConstant()) {
+            return true;
+        }
+        // Anything not defined here is referenced by name from the object that does define it.
+        ENSURE(!global->hasLocalLinkage());
+        return should_define(*global);
+    });
+    for (auto &global : llvm::make_early_inc_range(clone->globals())) {
+        global.removeDeadConstantUsers();
+        if (global.hasLocalLinkage() && global.use_empty()) {
+            global.eraseFromParent();
+        }
+    }
+    return clone;
+}
+
+} // namespace
+
+std::unique_ptr<llvm::MemoryBuffer> emit_object(llvm::Module &module, llvm::TargetMachine &machine) {
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream object_stream(buffer);
+    llvm::legacy::PassManager pm;
+    machine.addPassesToEmitFile(pm, object_stream, nullptr, llvm::CodeGenFileType::CGFT_ObjectFile);
+    pm.run(module);
+    return std::make_unique<llvm::SmallVectorMemoryBuffer>(std::move(buffer));
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+emit_partial_object(const llvm::Module &module, const std::function<bool(const llvm::GlobalValue &)> &should_define,
+                    llvm::TargetMachine &machine) {
+    auto partition = clone_partition(module, should_define);
+    return emit_object(*partition, machine);
+}
+
+std::vector<std::unique_ptr<llvm::MemoryBuffer>>
+emit_objects(const llvm::Module &module, const std::function<std::unique_ptr<llvm::TargetMachine>()> &create_machine,
+             unsigned thread_count) {
+    std::size_t partition_count = 0;
+    const auto partitions = partition_functions(module, partition_count);
+
+    // Modules in the same context can't be compiled concurrently, so each partition is cloned and round tripped
+    // through bitcode into its own context. Constant globals are copied into every partition that uses them, which is
+    // fine since they are private.
+    std::vector<llvm::SmallVector<char, 0>> bitcodes(partition_count);
+    for (std::size_t i = 0; i < partition_count; i++) {
+        auto clone = clone_partition(module, [&](const llvm::GlobalValue &global) {
+            auto it = partitions.find(&global);
+            return it == partitions.end() || it->second == i;
+        });
+        llvm::raw_svector_ostream bitcode_stream(bitcodes[i]);
+        llvm::WriteBitcodeToFile(*clone, bitcode_stream);
+    }
+
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects(partition_count);
+    std::atomic<std::size_t> next_partition = 0;
+    auto worker = [&] {
+        for (std::size_t i = next_partition++; i < partition_count; i = next_partition++) {
+            llvm::LLVMContext context;
+            llvm::MemoryBufferRef bitcode(llvm::StringRef(bitcodes[i].data(), bitcodes[i].size()), "partition");
+            auto partition = llvm::cantFail(llvm::parseBitcodeFile(bitcode, context));
+            objects[i] = emit_object(*partition, *create_machine());
+        }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < std::min<std::size_t>(thread_count, partition_count); i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return objects;
+}
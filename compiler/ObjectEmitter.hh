@@ -0,0 +1,27 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// @brief Generates an object file for `module`.
+std::unique_ptr<llvm::MemoryBuffer> emit_object(llvm::Module &module, llvm::TargetMachine &machine);
+
+/// @brief Generates an object file for part of `module`.
+/// @details Functions and mutable globals for which `should_define` returns false are only declared, and are expected to
+/// be defined by another object. Constant globals are copied into the object as needed.
+std::unique_ptr<llvm::MemoryBuffer>
+emit_partial_object(const llvm::Module &module, const std::function<bool(const llvm::GlobalValue &)> &should_define,
+                    llvm::TargetMachine &machine);
+
+/// @brief Splits `module` into partitions and generates an object file for each of them, using up to `thread_count`
+/// threads.
+/// @details The partitioning only depends on the module, so the same objects are emitted for any thread count.
+/// @param create_machine Called once per partition, possibly concurrently.
+std::vector<std::unique_ptr<llvm::MemoryBuffer>>
+emit_objects(const llvm::Module &module, const std::function<std::unique_ptr<llvm::TargetMachine>()> &create_machine,
+             unsigned thread_count);
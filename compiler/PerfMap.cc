@@ -0,0 +1,44 @@
+#include <PerfMap.hh>
+
+#include <support/Error.hh>
+
+#include <fmt/core.h>
+#include <llvm/Object/SymbolSize.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/Process.h>
+
+#include <string>
+
+PerfMapListener::PerfMapListener() {
+    auto path = fmt::format("/tmp/perf-{}.map", llvm::sys::Process::getProcessId());
+    m_stream.open(path, std::ios::app);
+    if (!m_stream) {
+        print_error_and_abort("Could not open perf map {}", path);
+    }
+}
+
+void PerfMapListener::notifyObjectLoaded(ObjectKey, const llvm::object::ObjectFile &object,
+                                         const llvm::RuntimeDyld::LoadedObjectInfo &info) {
+    // The debug object has its sections relocated to where they were loaded.
+    auto debug_object = info.getObjectForDebug(object);
+    if (debug_object.getBinary() == nullptr) {
+        return;
+    }
+    std::lock_guard lock(m_mutex);
+    for (const auto &[symbol, size] : llvm::object::computeSymbolSizes(*debug_object.getBinary())) {
+        auto type = symbol.getType();
+        if (!type || *type != llvm::object::SymbolRef::ST_Function || size == 0) {
+            llvm::consumeError(type.takeError());
+            continue;
+        }
+        auto name = symbol.getName();
+        auto address = symbol.getAddress();
+        if (!name || !address) {
+            llvm::consumeError(name.takeError());
+            llvm::consumeError(address.takeError());
+            continue;
+        }
+        m_stream << fmt::format("{:x} {:x} {}\n", *address, size, name->str());
+    }
+    m_stream.flush();
+}
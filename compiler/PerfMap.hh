@@ -0,0 +1,19 @@
+#pragma once
+
+#include <llvm/ExecutionEngine/JITEventListener.h>
+
+#include <fstream>
+#include <mutex>
+
+/// @brief A JIT event listener which writes the address range of every JIT compiled function to
+/// /tmp/perf-<pid>.map, where perf looks for symbols of code without a backing file.
+class PerfMapListener : public llvm::JITEventListener {
+    std::mutex m_mutex;
+    std::ofstream m_stream;
+
+public:
+    PerfMapListener();
+
+    void notifyObjectLoaded(ObjectKey key, const llvm::object::ObjectFile &object,
+                            const llvm::RuntimeDyld::LoadedObjectInfo &info) override;
+};
@@ -0,0 +1,105 @@
+#include <Profile.hh>
+
+#include <ir/BasicBlock.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <ir/Program.hh>
+#include <support/Error.hh>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+// FNV-1a, which is stable across runs and platforms, unlike std::hash.
+std::uint64_t hash_name(const std::string &name) {
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for (char ch : name) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3;
+    }
+    return hash;
+}
+
+std::size_t predecessor_count(const ir::BasicBlock *block) {
+    return std::count_if(block->users().begin(), block->users().end(), [](const ir::Value *user) {
+        const auto *inst = user->as_or_null<ir::Instruction>();
+        return inst != nullptr && inst->kind() != ir::InstKind::Phi;
+    });
+}
+
+} // namespace
+
+std::vector<FunctionProfileLayout> compute_profile_layout(const ir::Program *program) {
+    std::vector<FunctionProfileLayout> layout;
+    for (auto *function : *program) {
+        if (function->prototype()->externed() || function->name() == k_profile_write_function) {
+            continue;
+        }
+        auto &function_layout = layout.emplace_back();
+        function_layout.function = function;
+        function_layout.name_hash = hash_name(function->name());
+        for (auto *block : *function) {
+            function_layout.blocks.push_back(block);
+            for (auto *inst : *block) {
+                if (auto *call = inst->as_or_null<ir::CallInst>()) {
+                    function_layout.calls.push_back(call);
+                }
+            }
+        }
+    }
+    return layout;
+}
+
+Profile Profile::read(const ir::Program *program, const std::string &path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        print_error_and_abort("Could not open profile {}", path);
+    }
+    std::vector<char> bytes(std::istreambuf_iterator<char>(stream), {});
+    std::vector<std::uint64_t> words(bytes.size() / sizeof(std::uint64_t));
+    std::copy_n(bytes.data(), words.size() * sizeof(std::uint64_t), reinterpret_cast<char *>(words.data()));
+    if (bytes.size() % sizeof(std::uint64_t) != 0 || words.empty() || words[0] != k_profile_magic) {
+        print_error_and_abort("{} is not a kodo profile", path);
+    }
+
+    // Find where the counters of each function start.
+    std::unordered_map<std::uint64_t, std::pair<std::size_t, std::size_t>> records;
+    for (std::size_t i = 1; i < words.size();) {
+        if (i + 2 > words.size() || words[i + 1] > words.size() - i - 2) {
+            print_error_and_abort("{} is not a kodo profile", path);
+        }
+        records.emplace(words[i], std::make_pair(i + 2, words[i + 1]));
+        i += words[i + 1] + 2;
+    }
+
+    Profile profile;
+    for (const auto &function_layout : compute_profile_layout(program)) {
+        auto it = records.find(function_layout.name_hash);
+        if (it == records.end() || it->second.second != function_layout.counter_count()) {
+            print_error_and_abort("Profile {} was recorded for a different program", path);
+        }
+        auto counter = words.begin() + static_cast<std::ptrdiff_t>(it->second.first);
+        for (const auto *block : function_layout.blocks) {
+            profile.m_block_counts.emplace(block, *counter++);
+        }
+        for (const auto *call : function_layout.calls) {
+            profile.m_call_counts.emplace(call, *counter++);
+        }
+    }
+    return profile;
+}
+
+std::pair<std::uint64_t, std::uint64_t> Profile::branch_weights(const ir::CondBranchInst *cond_branch) const {
+    const auto count = block_count(cond_branch->parent());
+    const auto *true_dst = cond_branch->true_dst();
+    const auto *false_dst = cond_branch->false_dst();
+    auto true_count = std::min(block_count(true_dst), count);
+    auto false_count = std::min(block_count(false_dst), count);
+    if (predecessor_count(true_dst) == 1) {
+        false_count = count - true_count;
+    } else if (predecessor_count(false_dst) == 1) {
+        true_count = count - false_count;
+    }
+    return std::make_pair(true_count, false_count);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ir {
+
+class BasicBlock;
+class CallInst;
+class CondBranchInst;
+class Function;
+class Program;
+
+} // namespace ir
+
+/// @brief The first word of every profile, "KODOPROF" in little endian.
+constexpr std::uint64_t k_profile_magic = 0x464f52504f444f4b;
+
+/// @brief The function in std/profile.kd which writes out the counters of an instrumented program.
+constexpr const char *k_profile_write_function = "kodo_profile_write";
+
+/// @brief The blocks and calls counted in a function by an instrumented program, in the order of their counters.
+/// @details In a profile, the counters of each function are preceded by a hash of the function's name and the number
+/// of counters. Functions are matched up by name, since a program built with --profile-generate may contain functions,
+/// such as those used by the profile runtime, which are removed as dead when built with --profile-use.
+struct FunctionProfileLayout {
+    ir::Function *function;
+    std::uint64_t name_hash;
+    std::vector<ir::BasicBlock *> blocks;
+    std::vector<ir::CallInst *> calls;
+
+    std::size_t counter_count() const { return blocks.size() + calls.size(); }
+};
+
+/// @brief Returns the layout of every function apart from the profile runtime.
+std::vector<FunctionProfileLayout> compute_profile_layout(const ir::Program *program);
+
+/// @brief Execution counts of the blocks and calls of a program, read from a profile.
+class Profile {
+    std::unordered_map<const ir::BasicBlock *, std::uint64_t> m_block_counts;
+    std::unordered_map<const ir::CallInst *, std::uint64_t> m_call_counts;
+
+public:
+    /// @brief Reads the profile at `path`, which must have been written by `program` built with --profile-generate.
+    static Profile read(const ir::Program *program, const std::string &path);
+
+    /// @brief Estimates how many times each edge of `cond_branch` was taken.
+    /// @details Only block counts are recorded, so an edge count is exact when its destination has no other
+    /// predecessors and is derived from the other edge otherwise.
+    std::pair<std::uint64_t, std::uint64_t> branch_weights(const ir::CondBranchInst *cond_branch) const;
+
+    std::uint64_t block_count(const ir::BasicBlock *block) const { return m_block_counts.at(block); }
+    std::uint64_t call_count(const ir::CallInst *call) const { return m_call_counts.at(call); }
+};
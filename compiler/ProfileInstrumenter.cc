@@ -0,0 +1,109 @@
+#include <ProfileInstrumenter.hh>
+
+#include <Profile.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Constants.hh>
+#include <ir/DataLayout.hh>
+#include <ir/Function.hh>
+#include <ir/GlobalVariable.hh>
+#include <ir/Instructions.hh>
+#include <ir/Program.hh>
+#include <ir/Types.hh>
+#include <support/Error.hh>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+ir::Function *find_function(ir::Program *program, const std::string &name) {
+    for (auto *function : *program) {
+        if (!function->prototype()->externed() && function->name() == name) {
+            return function;
+        }
+    }
+    return nullptr;
+}
+
+// Returns the call of `callee_name` in `function`.
+ir::CallInst *find_call(ir::Function *function, const std::string &callee_name) {
+    for (auto *block : *function) {
+        for (auto *inst : *block) {
+            auto *call = inst->as_or_null<ir::CallInst>();
+            if (call != nullptr && call->callee()->has_name() && call->callee()->name() == callee_name) {
+                return call;
+            }
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void ProfileInstrumenter::run(ir::Program *program) {
+    auto *start = find_function(program, "_start");
+    auto *exit_call = start != nullptr ? find_call(start, "sys_exit") : nullptr;
+    auto *write_function = find_function(program, k_profile_write_function);
+    if (exit_call == nullptr || write_function == nullptr) {
+        print_error_and_abort("--profile-generate requires the std/start.kd and std/profile.kd runtime");
+    }
+
+    // The counters are laid out as they are written to the profile, with a header before each function's counters.
+    const auto layout = compute_profile_layout(program);
+    const auto *u32 = program->int_type(32, false);
+    const auto *u64 = program->int_type(64, false);
+    std::vector<ir::Value *> initial_counters{ir::ConstantInt::get(u64, k_profile_magic)};
+    for (const auto &function_layout : layout) {
+        initial_counters.push_back(ir::ConstantInt::get(u64, function_layout.name_hash));
+        initial_counters.push_back(ir::ConstantInt::get(u64, function_layout.counter_count()));
+        initial_counters.insert(initial_counters.end(), function_layout.counter_count(), ir::ConstantInt::get(u64, 0));
+    }
+    const auto *counters_type = program->array_type(u64, initial_counters.size());
+    auto *counters = program->append_global(ir::ConstantArray::get(counters_type, std::move(initial_counters)), true);
+    counters->set_name("profile.counters");
+
+    // Inserts `counters[counter_index]++` before `position`.
+    auto increment = [&](ir::BasicBlock *block, ir::BasicBlock::iterator position, std::size_t counter_index) {
+        std::vector<ir::Value *> indices{ir::ConstantInt::get(u32, 0), ir::ConstantInt::get(u32, counter_index)};
+        auto *counter = block->insert<ir::LeaInst>(position, counters, std::move(indices));
+        counter->set_type(program->pointer_type(u64, true));
+        auto *count = block->insert<ir::LoadInst>(position, counter);
+        auto *new_count =
+            block->insert<ir::BinaryInst>(position, ir::BinaryOp::Add, count, ir::ConstantInt::get(u64, 1));
+        new_count->set_type(u64);
+        block->insert<ir::StoreInst>(position, counter, new_count);
+    };
+    std::size_t index = 1;
+    std::optional<std::size_t> exit_entry_index;
+    for (const auto &function_layout : layout) {
+        index += 2;
+        for (auto *block : function_layout.blocks) {
+            if (function_layout.function == exit_call->callee() && block == function_layout.function->entry()) {
+                exit_entry_index = index;
+            }
+            auto position = block->begin();
+            while (position != block->end() && (*position)->kind() == ir::InstKind::Phi) {
+                ++position;
+            }
+            increment(block, position, index++);
+        }
+        for (auto *call : function_layout.calls) {
+            increment(call->parent(), call->parent()->position(call), index++);
+        }
+    }
+
+    // The exit call only enters its callee after the counters have been written, so its entry is counted beforehand.
+    // Otherwise the callee would always look like it never runs, and be marked cold by --profile-use.
+    auto *exit_block = exit_call->parent();
+    if (exit_entry_index) {
+        increment(exit_block, exit_block->position(exit_call), *exit_entry_index);
+    }
+
+    // Write the counters out just before the program exits.
+    const auto *counters_ptr_type = program->pointer_type(program->int_type(8, false), false);
+    auto *counters_ptr = exit_block->insert<ir::CastInst>(exit_block->position(exit_call), ir::CastOp::Reinterpret,
+                                                          counters_ptr_type, counters);
+    std::vector<ir::Value *> args{counters_ptr, ir::ConstantInt::get(u64, ir::size_of(counters_type))};
+    exit_block->insert<ir::CallInst>(exit_block->position(exit_call), write_function, std::move(args));
+}
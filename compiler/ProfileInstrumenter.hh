@@ -0,0 +1,13 @@
+#pragma once
+
+#include <pass/Pass.hh>
+
+/// @brief Counts how many times every basic block and call is executed, for --profile-generate.
+/// @details The counters live in a mutable global which is laid out as a profile. Just before `_start` exits, the
+/// global is written to kodo.profraw by the profile runtime in std/profile.kd. Should run after all other transforms so
+/// that the counted blocks are the ones which end up being compiled.
+struct ProfileInstrumenter : public Pass {
+    constexpr explicit ProfileInstrumenter(PassManager *manager) : Pass(manager) {}
+
+    void run(ir::Program *) override;
+};
@@ -0,0 +1,204 @@
+#include <Remarks.hh>
+
+#include <Profile.hh>
+#include <ir/Function.hh>
+#include <ir/Program.hh>
+#include <support/Error.hh>
+
+#include <fmt/core.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/LLVMRemarkStreamer.h>
+#include <llvm/Remarks/Remark.h>
+#include <llvm/Remarks/RemarkFormat.h>
+#include <llvm/Remarks/RemarkParser.h>
+#include <llvm/Remarks/RemarkSerializer.h>
+#include <llvm/Remarks/RemarkStreamer.h>
+#include <llvm/Remarks/RemarkStringTable.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+llvm::remarks::Format parse_format(const std::string &format) {
+    auto parsed = llvm::remarks::parseFormat(format);
+    if (!parsed || (*parsed != llvm::remarks::Format::YAML && *parsed != llvm::remarks::Format::Bitstream)) {
+        llvm::consumeError(parsed.takeError());
+        print_error_and_abort("Unknown remarks format {}", format);
+    }
+    return *parsed;
+}
+
+llvm::remarks::Type llvm_remark_type(RemarkKind kind) {
+    switch (kind) {
+    case RemarkKind::Passed:
+        return llvm::remarks::Type::Passed;
+    case RemarkKind::Missed:
+        return llvm::remarks::Type::Missed;
+    case RemarkKind::Analysis:
+        return llvm::remarks::Type::Analysis;
+    }
+    ENSURE_NOT_REACHED();
+}
+
+struct LineSummary {
+    std::string file;
+    unsigned line{0};
+    std::size_t count{0};
+    std::optional<std::uint64_t> hotness;
+    std::set<std::string> names;
+};
+
+} // namespace
+
+RemarkStream::RemarkStream(llvm::LLVMContext *context, const std::string &path, const std::string &format,
+                           bool with_hotness)
+    : m_context(context), m_format(parse_format(format)), m_stream(m_buffer) {
+    // The file is opened up front so that a bad path is reported before any work is done, and without having to abort
+    // from the destructor.
+    std::error_code ec;
+    m_file = new llvm::raw_fd_ostream(path, ec);
+    if (ec) {
+        print_error_and_abort("Could not open remarks file {}: {}", path, ec.message());
+    }
+    llvm::cantFail(llvm::setupLLVMOptimizationRemarks(*context, m_stream, "", "yaml", with_hotness));
+}
+
+RemarkStream::~RemarkStream() {
+    auto &file = **m_file;
+    llvm::StringRef yaml(m_buffer.data(), m_buffer.size());
+    if (m_format == llvm::remarks::Format::YAML) {
+        file << yaml;
+        return;
+    }
+
+    // LLVM only streams bitstream remarks as an addition to an object file, since the string table is written to the
+    // object. A standalone file needs the string table up front, so is written once all remarks are known.
+    llvm::remarks::StringTable string_table;
+    std::vector<std::unique_ptr<llvm::remarks::Remark>> remarks;
+    auto parser = llvm::cantFail(llvm::remarks::createRemarkParser(llvm::remarks::Format::YAML, yaml));
+    while (true) {
+        auto remark = parser->next();
+        if (!remark) {
+            llvm::cantFail(llvm::handleErrors(remark.takeError(), [](const llvm::remarks::EndOfFileError &) {}));
+            break;
+        }
+        string_table.internalize(**remark);
+        remarks.push_back(std::move(*remark));
+    }
+    auto serializer = llvm::cantFail(llvm::remarks::createRemarkSerializer(
+        llvm::remarks::Format::Bitstream, llvm::remarks::SerializerMode::Standalone, file, std::move(string_table)));
+    for (const auto &remark : remarks) {
+        serializer->emit(*remark);
+    }
+}
+
+void RemarkStream::emit(RemarkKind kind, const char *pass, const char *name, const ir::Function *function, int line,
+                        std::string message) {
+    m_remarks.push_back({kind, pass, name, function->name(), llvm::sys::path::filename(function->file()).str(),
+                         line >= 0 ? line : function->line(), std::move(message)});
+}
+
+void RemarkStream::flush(const ir::Program *program, const Profile *profile) {
+    std::unordered_map<std::string, std::uint64_t> entry_counts;
+    for (const auto *function : *program) {
+        if (profile != nullptr && !function->prototype()->externed()) {
+            entry_counts.emplace(function->name(), profile->block_count(function->entry()));
+        }
+    }
+
+    auto &serializer = m_context->getMainRemarkStreamer()->getSerializer();
+    for (const auto &remark : m_remarks) {
+        llvm::remarks::Remark llvm_remark;
+        llvm_remark.RemarkType = llvm_remark_type(remark.kind);
+        llvm_remark.PassName = remark.pass;
+        llvm_remark.RemarkName = remark.name;
+        llvm_remark.FunctionName = remark.function;
+        llvm_remark.Loc =
+            llvm::remarks::RemarkLocation{remark.file, static_cast<unsigned>(std::max(remark.line, 0)), 0};
+        if (auto it = entry_counts.find(remark.function); it != entry_counts.end()) {
+            llvm_remark.Hotness = it->second;
+        }
+        auto &arg = llvm_remark.Args.emplace_back();
+        arg.Key = "String";
+        arg.Val = remark.message;
+        serializer.emit(llvm_remark);
+    }
+    m_remarks.clear();
+}
+
+int print_remark_summary(const std::string &path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        print_error_and_abort("Could not open remarks file {}", path);
+    }
+
+    std::map<std::pair<std::string, unsigned>, LineSummary> lines;
+    auto contents = (*buffer)->getBuffer();
+    if (!contents.empty()) {
+        auto format = llvm::remarks::magicToFormat(contents);
+        if (!format) {
+            print_error_and_abort("{} is not a remarks file: {}", path, llvm::toString(format.takeError()));
+        }
+        auto parser = llvm::remarks::createRemarkParserFromMeta(*format, contents);
+        if (!parser) {
+            print_error_and_abort("Could not read {}: {}", path, llvm::toString(parser.takeError()));
+        }
+        while (true) {
+            auto remark = (*parser)->next();
+            if (!remark) {
+                auto error = llvm::handleErrors(remark.takeError(), [](const llvm::remarks::EndOfFileError &) {});
+                if (error) {
+                    print_error_and_abort("Could not read {}: {}", path, llvm::toString(std::move(error)));
+                }
+                break;
+            }
+            const auto &llvm_remark = **remark;
+            if (llvm_remark.RemarkType != llvm::remarks::Type::Missed) {
+                continue;
+            }
+            std::string file = llvm_remark.Loc ? llvm_remark.Loc->SourceFilePath.str() : "<unknown>";
+            unsigned line = llvm_remark.Loc ? llvm_remark.Loc->SourceLine : 0;
+            auto &summary = lines[std::make_pair(file, line)];
+            summary.file = std::move(file);
+            summary.line = line;
+            summary.count++;
+            if (llvm_remark.Hotness) {
+                summary.hotness = std::max(summary.hotness.value_or(0), *llvm_remark.Hotness);
+            }
+            summary.names.insert(fmt::format("{}/{}", llvm_remark.PassName.str(), llvm_remark.RemarkName.str()));
+        }
+    }
+
+    // Hottest lines first, then those with the most missed optimisations.
+    std::vector<const LineSummary *> sorted;
+    for (const auto &[location, summary] : lines) {
+        sorted.push_back(&summary);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const LineSummary *lhs, const LineSummary *rhs) {
+        if (lhs->hotness != rhs->hotness) {
+            return lhs->hotness.value_or(0) > rhs->hotness.value_or(0) || !rhs->hotness;
+        }
+        return lhs->count > rhs->count;
+    });
+    if (sorted.empty()) {
+        fmt::print("no missed optimisations\n");
+    }
+    for (const auto *summary : sorted) {
+        std::string names;
+        for (const auto &name : summary->names) {
+            names += (names.empty() ? "" : ", ") + name;
+        }
+        auto hotness = summary->hotness ? fmt::format(" (hotness {})", *summary->hotness) : "";
+        fmt::print("{}:{}: {} missed{}: {}\n", summary->file, summary->line, summary->count, hotness, names);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <support/Box.hh>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Remarks/RemarkFormat.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <string>
+#include <vector>
+
+namespace ir {
+
+class Function;
+class Program;
+
+} // namespace ir
+
+namespace llvm {
+
+class LLVMContext;
+
+} // namespace llvm
+
+class Profile;
+
+enum class RemarkKind {
+    // An optimisation was applied.
+    Passed,
+    // An optimisation wasn't applied.
+    Missed,
+    Analysis,
+};
+
+/// @brief An optimisation remark from one of kodo's own passes.
+struct Remark {
+    RemarkKind kind;
+    std::string pass;
+    std::string name;
+    std::string function;
+    std::string file;
+    int line;
+    std::string message;
+};
+
+/// @brief Writes optimisation remarks to a file, for --remarks.
+/// @details Remarks from LLVM are streamed by the LLVM context as code is generated. Remarks from kodo passes are held
+/// until `flush`, which gives them the execution count of their function as hotness when a profile is available, the
+/// same as LLVM does. Both are keyed by source file name and line. Everything is buffered as YAML and written to the
+/// file on destruction, so must outlive the LLVM context.
+class RemarkStream {
+    llvm::LLVMContext *const m_context;
+    const llvm::remarks::Format m_format;
+    Box<llvm::raw_fd_ostream> m_file;
+    llvm::SmallVector<char, 0> m_buffer;
+    llvm::raw_svector_ostream m_stream;
+    std::vector<Remark> m_remarks;
+
+public:
+    /// @brief Opens the remarks file at `path`, which is written once the stream is destroyed.
+    /// @param format Either "yaml" or "bitstream".
+    RemarkStream(llvm::LLVMContext *context, const std::string &path, const std::string &format, bool with_hotness);
+    RemarkStream(const RemarkStream &) = delete;
+    RemarkStream(RemarkStream &&) = delete;
+    ~RemarkStream();
+
+    RemarkStream &operator=(const RemarkStream &) = delete;
+    RemarkStream &operator=(RemarkStream &&) = delete;
+
+    /// @param line The source line the remark is about, or -1 to use the line of `function`.
+    void emit(RemarkKind kind, const char *pass, const char *name, const ir::Function *function, int line,
+              std::string message);
+    void flush(const ir::Program *program, const Profile *profile);
+};
+
+/// @brief Prints the missed optimisations recorded in the remarks file at `path`, grouped by source line with the
+/// hottest lines first.
+/// @return The process exit code.
+int print_remark_summary(const std::string &path);
@@ -0,0 +1,325 @@
+#include <Server.hh>
+
+#include <support/Error.hh>
+
+#include <fmt/core.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// Requests are prefixed with their length, and carry the client's stdin, stdout and stderr as ancillary data.
+// Responses are the exit code followed by the diagnostics, terminated by the server closing the connection.
+constexpr std::size_t k_passed_fd_count = 3;
+constexpr std::uint32_t k_max_request_length = 1U << 20U;
+
+sockaddr_un socket_address(const std::string &socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        print_error_and_abort("Socket path {} is too long", socket_path);
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+    return address;
+}
+
+bool write_all(int fd, const void *data, std::size_t size) {
+    const auto *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        auto written = ::write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, void *data, std::size_t size) {
+    auto *bytes = static_cast<char *>(data);
+    while (size > 0) {
+        auto bytes_read = ::read(fd, bytes, size);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            return false;
+        }
+        bytes += bytes_read;
+        size -= static_cast<std::size_t>(bytes_read);
+    }
+    return true;
+}
+
+// Receives the length of a request along with the client's standard streams.
+bool receive_header(int connection, std::uint32_t &length, std::array<int, k_passed_fd_count> &fds) {
+    std::array<char, CMSG_SPACE(sizeof(int) * k_passed_fd_count)> control{};
+    iovec iov{&length, sizeof(length)};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    if (::recvmsg(connection, &message, MSG_WAITALL) != sizeof(length)) {
+        return false;
+    }
+    auto *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * k_passed_fd_count)) {
+        return false;
+    }
+    std::memcpy(fds.data(), CMSG_DATA(cmsg), sizeof(int) * k_passed_fd_count);
+    return true;
+}
+
+// Installs the client's standard streams and working directory for the lifetime of the object.
+class ClientEnvironment {
+    std::array<int, k_passed_fd_count> m_saved_fds{};
+    std::filesystem::path m_saved_cwd;
+
+public:
+    ClientEnvironment(const std::array<int, k_passed_fd_count> &fds, const std::string &cwd) {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        m_saved_cwd = std::filesystem::current_path();
+        for (std::size_t i = 0; i < k_passed_fd_count; i++) {
+            m_saved_fds[i] = ::dup(static_cast<int>(i));
+            ::dup2(fds[i], static_cast<int>(i));
+        }
+        std::error_code ec;
+        std::filesystem::current_path(cwd, ec);
+    }
+    ClientEnvironment(const ClientEnvironment &) = delete;
+    ClientEnvironment(ClientEnvironment &&) = delete;
+    ~ClientEnvironment() {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        llvm::outs().flush();
+        for (std::size_t i = 0; i < k_passed_fd_count; i++) {
+            ::dup2(m_saved_fds[i], static_cast<int>(i));
+            ::close(m_saved_fds[i]);
+        }
+        std::error_code ec;
+        std::filesystem::current_path(m_saved_cwd, ec);
+    }
+
+    ClientEnvironment &operator=(const ClientEnvironment &) = delete;
+    ClientEnvironment &operator=(ClientEnvironment &&) = delete;
+};
+
+// Handles a request in the current process, returning its exit code and collecting its diagnostics.
+std::int32_t handle_request_here(const std::array<int, k_passed_fd_count> &fds, const std::string &cwd,
+                                 const std::vector<std::string> &args,
+                                 const std::function<int(const std::vector<std::string> &)> &handle_request,
+                                 std::string &diagnostics) {
+    ClientEnvironment environment(fds, cwd);
+    g_error = false;
+    g_diagnostics = &diagnostics;
+    std::int32_t exit_code = 0;
+    try {
+        exit_code = handle_request(args);
+    } catch (const CompilationAborted &) {
+        exit_code = 1;
+    } catch (const std::exception &exception) {
+        diagnostics += fmt::format("{}\n", exception.what());
+        exit_code = 1;
+    }
+    g_diagnostics = nullptr;
+    return exit_code;
+}
+
+bool send_response(int connection, std::int32_t exit_code, const std::string &diagnostics) {
+    return write_all(connection, &exit_code, sizeof(exit_code)) &&
+           write_all(connection, diagnostics.data(), diagnostics.size());
+}
+
+void handle_connection(int connection, const std::function<void()> &prepare_request,
+                       const std::function<int(const std::vector<std::string> &)> &handle_request) {
+    std::uint32_t length = 0;
+    std::array<int, k_passed_fd_count> fds{-1, -1, -1};
+    auto close_fds = [&] {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+    std::string payload;
+    if (!receive_header(connection, length, fds) || length > k_max_request_length) {
+        close_fds();
+        return;
+    }
+    payload.resize(length);
+    if (!read_all(connection, payload.data(), payload.size())) {
+        close_fds();
+        return;
+    }
+
+    // The payload is the working directory followed by the arguments, each terminated by a null character.
+    std::vector<std::string> args;
+    for (std::size_t start = 0; start < payload.size();) {
+        auto end = payload.find('\0', start);
+        if (end == std::string::npos) {
+            end = payload.size();
+        }
+        args.push_back(payload.substr(start, end - start));
+        start = end + 1;
+    }
+    auto cwd = args.empty() ? "." : args.front();
+    if (!args.empty()) {
+        args.erase(args.begin());
+    }
+
+    // Anything failing here will fail again while handling the request, where it's reported to the client.
+    std::string ignored_diagnostics;
+    g_diagnostics = &ignored_diagnostics;
+    try {
+        prepare_request();
+    } catch (const CompilationAborted &) {
+    }
+    g_diagnostics = nullptr;
+    g_error = false;
+
+    // The request is handled in a child forked from the server, so that it starts from the server's warm state but
+    // can't take the server down by crashing. The child responds itself and exits with zero once it has done so.
+    std::fflush(stdout);
+    std::fflush(stderr);
+    pid_t pid = ::fork();
+    int fork_error = errno;
+    if (pid == 0) {
+        std::string diagnostics;
+        auto exit_code = handle_request_here(fds, cwd, args, handle_request, diagnostics);
+        ::_exit(send_response(connection, exit_code, diagnostics) ? 0 : 1);
+    }
+    close_fds();
+    int status = 0;
+    while (pid > 0 && ::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return;
+    }
+
+    // The child couldn't be forked or died before responding.
+    std::string diagnostics;
+    g_diagnostics = &diagnostics;
+    std::int32_t exit_code = 1;
+    if (pid < 0) {
+        print_error("Could not fork: {}", std::strerror(fork_error));
+    } else if (WIFSIGNALED(status)) {
+        exit_code = 128 + WTERMSIG(status);
+        print_error("Compiler crashed with signal {}", WTERMSIG(status));
+        print_note("This is a compiler bug!");
+    } else {
+        exit_code = WEXITSTATUS(status);
+    }
+    g_diagnostics = nullptr;
+    g_error = false;
+    send_response(connection, exit_code, diagnostics);
+}
+
+} // namespace
+
+int serve(const std::string &socket_path, const std::function<void()> &prepare_request,
+          const std::function<int(const std::vector<std::string> &)> &handle_request) {
+    auto address = socket_address(socket_path);
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ::unlink(socket_path.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, SOMAXCONN) != 0) {
+        print_error_and_abort("Could not listen on {}: {}", socket_path, std::strerror(errno));
+    }
+
+    // Clients going away mid-response shouldn't take the server down with them.
+    std::signal(SIGPIPE, SIG_IGN);
+    while (true) {
+        int connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0) {
+            continue;
+        }
+        handle_connection(connection, prepare_request, handle_request);
+        ::close(connection);
+    }
+}
+
+int forward_to_server(const std::string &socket_path, const std::vector<std::string> &args) {
+    auto address = socket_address(socket_path);
+    int connection = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection < 0 || ::connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        print_error_and_abort("Could not connect to server at {}: {}", socket_path, std::strerror(errno));
+    }
+
+    std::string payload = std::filesystem::current_path().string();
+    payload += '\0';
+    for (const auto &arg : args) {
+        payload += arg;
+        payload += '\0';
+    }
+    auto length = static_cast<std::uint32_t>(payload.size());
+    std::array<char, CMSG_SPACE(sizeof(int) * k_passed_fd_count)> control{};
+    iovec iov{&length, sizeof(length)};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    auto *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * k_passed_fd_count);
+    const std::array<int, k_passed_fd_count> fds{STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * k_passed_fd_count);
+    std::fflush(stdout);
+    std::int32_t exit_code = 0;
+    if (::sendmsg(connection, &message, 0) != sizeof(length) ||
+        !write_all(connection, payload.data(), payload.size()) ||
+        !read_all(connection, &exit_code, sizeof(exit_code))) {
+        print_error_and_abort("Lost connection to server at {}", socket_path);
+    }
+
+    std::array<char, 4096> buffer{};
+    ssize_t bytes_read = 0;
+    while ((bytes_read = ::read(connection, buffer.data(), buffer.size())) > 0) {
+        std::fwrite(buffer.data(), 1, static_cast<std::size_t>(bytes_read), stdout);
+    }
+    ::close(connection);
+    return exit_code;
+}
+
+int run_in_child(const std::function<int()> &function) {
+    std::fflush(stdout);
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        print_error_and_abort("Could not fork: {}", std::strerror(errno));
+    }
+    if (pid == 0) {
+        // Anything printed by the program goes straight to the client.
+        g_diagnostics = nullptr;
+        int exit_code = function();
+        std::fflush(stdout);
+        llvm::outs().flush();
+        ::_exit(exit_code);
+    }
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
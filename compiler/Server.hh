@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Compiler.hh>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/// @brief State kept warm between the requests handled by `kodoc serve`.
+struct ServerState {
+    ParseCache parse_cache;
+};
+
+/// @brief Listens on the Unix socket at `socket_path` for requests sent by `forward_to_server`, and handles them one at
+/// a time with `handle_request`.
+/// @details A request carries the client's command line, working directory and standard streams. `prepare_request` is
+/// first run in the server itself, to fill the state kept warm between requests. The request is then handled in a
+/// child forked from the server, so that a crash only takes down that request. The streams and working directory are
+/// swapped in while the request is handled, and diagnostics are collected rather than printed, so that they can be
+/// returned to the client along with the exit code. Only returns if the socket can't be set up.
+int serve(const std::string &socket_path, const std::function<void()> &prepare_request,
+          const std::function<int(const std::vector<std::string> &)> &handle_request);
+
+/// @brief Sends the command line `args` to the server listening at `socket_path` and prints the returned diagnostics.
+/// @return The exit code of the request.
+int forward_to_server(const std::string &socket_path, const std::vector<std::string> &args);
+
+/// @brief Runs `function` in a child process, so that a program run for a request can't exit or crash before the
+/// request has responded.
+/// @return The exit code of the child.
+int run_in_child(const std::function<int()> &function);
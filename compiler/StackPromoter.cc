@@ -1,40 +1,85 @@
 #include <StackPromoter.hh>
 
+#include <Remarks.hh>
+#include <analyses/MemorySsaAnalysis.hh>
 #include <analyses/ReachingDefAnalysis.hh>
 #include <ir/Function.hh>
 #include <ir/Instructions.hh>
+#include <pass/PassManager.hh>
 #include <pass/PassUsage.hh>
 
+#include <fmt/core.h>
+
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace {
 
-bool is_promotable(ir::LocalVar *var) {
+// Returns the first user of `var` which prevents it from being promoted, or null if it can be promoted.
+ir::Instruction *find_unpromotable_user(ir::LocalVar *var) {
     for (auto *user : var->users()) {
         auto *inst = user->as_or_null<ir::Instruction>();
         if (inst == nullptr) {
             continue;
         }
         if (inst->as_or_null<ir::CallInst>() != nullptr) {
-            return false;
+            return inst;
         }
         if (inst->as_or_null<ir::CastInst>() != nullptr) {
-            return false;
+            return inst;
         }
         // TODO: Better inline asm output handling.
         if (inst->as_or_null<ir::InlineAsmInst>() != nullptr) {
-            return false;
+            return inst;
         }
         if (inst->as_or_null<ir::LeaInst>() != nullptr) {
-            return false;
+            return inst;
         }
         auto *store = inst->as_or_null<ir::StoreInst>();
         if (store != nullptr && store->ptr() != var) {
-            return false;
+            return inst;
+        }
+    }
+    return nullptr;
+}
+
+std::string var_name(ir::LocalVar *var) {
+    return var->has_name() ? fmt::format("'{}'", var->name()) : "temporary";
+}
+
+void emit_remark(RemarkStream *remarks, ir::Function *function, ir::LocalVar *var, ir::Instruction *blocker) {
+    if (blocker == nullptr) {
+        int line = -1;
+        for (auto *user : var->users()) {
+            auto *inst = user->as_or_null<ir::Instruction>();
+            if (inst != nullptr && inst->line() >= 0 && (line < 0 || inst->line() < line)) {
+                line = inst->line();
+            }
         }
+        remarks->emit(RemarkKind::Passed, "stack-promoter", "Promoted", function, line,
+                      fmt::format("promoted {} to a register", var_name(var)));
+        return;
+    }
+    const char *reason = "its address is stored";
+    switch (blocker->kind()) {
+    case ir::InstKind::Call:
+        reason = "its address is passed to a call";
+        break;
+    case ir::InstKind::Cast:
+        reason = "its address is cast";
+        break;
+    case ir::InstKind::InlineAsm:
+        reason = "it is used by inline asm";
+        break;
+    case ir::InstKind::Lea:
+        reason = "part of it is accessed through its address";
+        break;
+    default:
+        break;
     }
-    return true;
+    remarks->emit(RemarkKind::Missed, "stack-promoter", "NotPromoted", function, blocker->line(),
+                  fmt::format("{} not promoted to a register because {}", var_name(var), reason));
 }
 
 } // namespace
@@ -50,9 +95,13 @@ void StackPromoter::run(ir::Function *function) {
 
     std::unordered_set<ir::LocalVar *> promotable_vars;
     for (auto *var : function->vars()) {
-        if (is_promotable(var)) {
+        auto *blocker = find_unpromotable_user(var);
+        if (blocker == nullptr) {
             promotable_vars.insert(var);
         }
+        if (auto *remarks = m_manager->remarks()) {
+            emit_remark(remarks, function, var, blocker);
+        }
     }
 
     auto *rda = m_manager->get<ReachingDefAnalysis>(function);
@@ -64,16 +113,19 @@ void StackPromoter::run(ir::Function *function) {
                 continue;
             }
             ASSERT(!phi_map.contains(memory_phi));
-            auto *phi = block->prepend<ir::PhiInst>();
-            phi_map.emplace(memory_phi, phi);
-            for (auto [block, value] : memory_phi->incoming()) {
-                if (auto *incoming_memory_phi = value != nullptr ? value->as_or_null<MemoryPhi>() : nullptr) {
-                    value = phi_map.at(incoming_memory_phi);
-                }
-                phi->add_incoming(block, value);
-                if (value != nullptr) {
-                    phi->set_type(value->type());
-                }
+            phi_map.emplace(memory_phi, block->prepend<ir::PhiInst>());
+        }
+    }
+
+    // Incoming values may be memory phis from blocks later in the function, so all phis must be created first.
+    for (auto [memory_phi, phi] : phi_map) {
+        for (auto [block, value] : memory_phi->incoming()) {
+            if (auto *incoming_memory_phi = value != nullptr ? value->as_or_null<MemoryPhi>() : nullptr) {
+                value = phi_map.at(incoming_memory_phi);
+            }
+            phi->add_incoming(block, value);
+            if (value != nullptr) {
+                phi->set_type(value->type());
             }
         }
     }
@@ -97,4 +149,6 @@ void StackPromoter::run(ir::Function *function) {
         }
         function->remove_var(var);
     }
+    m_manager->invalidate<MemorySsaAnalysis>(function);
+    m_manager->invalidate<ReachingDefAnalysis>(function);
 }
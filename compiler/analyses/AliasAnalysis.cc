@@ -0,0 +1,223 @@
+#include <analyses/AliasAnalysis.hh>
+
+#include <ir/Constants.hh>
+#include <ir/Function.hh>
+#include <ir/GlobalVariable.hh>
+#include <ir/Instructions.hh>
+#include <ir/Types.hh>
+#include <pass/PassManager.hh>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+// The underlying object of a pointer and the constant lea indices used to reach it from that object.
+struct AccessPath {
+    ir::Value *root{nullptr};
+    std::vector<std::size_t> indices;
+    bool exact{true};
+};
+
+AccessPath access_path(ir::Value *ptr) {
+    AccessPath path;
+    std::vector<std::size_t> reversed;
+    while (auto *inst = ptr->as_or_null<ir::Instruction>()) {
+        if (auto *cast = inst->as_or_null<ir::CastInst>()) {
+            if (!cast->type()->is<ir::PointerType>() || !cast->val()->type()->is<ir::PointerType>()) {
+                break;
+            }
+            path.exact = false;
+            ptr = cast->val();
+            continue;
+        }
+        auto *lea = inst->as_or_null<ir::LeaInst>();
+        if (lea == nullptr) {
+            break;
+        }
+        for (auto it = lea->indices().rbegin(); it != lea->indices().rend(); ++it) {
+            auto *constant = (*it)->as_or_null<ir::Constant>();
+            const auto *constant_int = constant != nullptr ? constant->as_or_null<ir::ConstantInt>() : nullptr;
+            if (constant_int == nullptr) {
+                path.exact = false;
+                continue;
+            }
+            reversed.push_back(constant_int->value());
+        }
+        ptr = lea->ptr();
+    }
+    path.root = ptr;
+    path.indices.assign(reversed.rbegin(), reversed.rend());
+    return path;
+}
+
+// Returns true if `root` is an object distinct from every other object, i.e. a local variable or global.
+bool is_identified_object(ir::Value *root) {
+    return root->as_or_null<ir::LocalVar>() != nullptr || root->as_or_null<ir::GlobalVariable>() != nullptr;
+}
+
+EscapeKind escape_through(const ir::Type *type) {
+    const auto *pointer_type = type->as_or_null<ir::PointerType>();
+    return pointer_type != nullptr && !pointer_type->is_mutable() ? EscapeKind::ReadOnly : EscapeKind::Full;
+}
+
+EscapeKind escape_kind_of(ir::Value *ptr) {
+    EscapeKind kind = EscapeKind::None;
+    auto merge = [&](EscapeKind other) {
+        kind = std::max(kind, other);
+    };
+    for (auto *user : ptr->users()) {
+        auto *inst = user->as_or_null<ir::Instruction>();
+        if (inst == nullptr) {
+            continue;
+        }
+        switch (inst->kind()) {
+        case ir::InstKind::Call: {
+            auto *call = inst->as<ir::CallInst>();
+            const auto *function_type = call->callee()->type()->as_or_null<ir::FunctionType>();
+            for (std::size_t i = 0; i < call->args().size(); i++) {
+                if (call->args()[i] != ptr) {
+                    continue;
+                }
+                bool has_param = function_type != nullptr && i < function_type->params().size();
+                merge(has_param ? escape_through(function_type->params()[i]) : EscapeKind::Full);
+            }
+            break;
+        }
+        case ir::InstKind::Cast:
+            merge(inst->type()->is<ir::PointerType>() ? escape_kind_of(inst) : EscapeKind::Full);
+            break;
+        case ir::InstKind::Compare:
+            break;
+        case ir::InstKind::Copy:
+            if (inst->as<ir::CopyInst>()->len() == ptr) {
+                merge(EscapeKind::Full);
+            }
+            break;
+        case ir::InstKind::InlineAsm:
+            // Inline asm may write through any pointer it is given.
+            for (const auto &[input, value] : inst->as<ir::InlineAsmInst>()->inputs()) {
+                if (value == ptr) {
+                    merge(EscapeKind::Full);
+                }
+            }
+            break;
+        case ir::InstKind::Lea:
+            merge(inst->as<ir::LeaInst>()->ptr() == ptr ? escape_kind_of(inst) : EscapeKind::Full);
+            break;
+        case ir::InstKind::Load:
+            break;
+        case ir::InstKind::Store: {
+            auto *store = inst->as<ir::StoreInst>();
+            if (store->val() == ptr) {
+                merge(escape_through(store->ptr()->type()->as<ir::PointerType>()->pointee_type()));
+            }
+            break;
+        }
+        default:
+            merge(EscapeKind::Full);
+            break;
+        }
+    }
+    return kind;
+}
+
+} // namespace
+
+// Returns true if the memory pointed to by `ptr` can only be written through pointers derived from its local variable
+// within this function.
+bool AliasAnalysis::is_only_locally_writable(ir::Value *ptr) const {
+    auto *var = access_path(ptr).root->as_or_null<ir::LocalVar>();
+    return var != nullptr && escape_kind(var) != EscapeKind::Full;
+}
+
+AliasResult AliasAnalysis::alias(ir::Value *lhs, ir::Value *rhs) const {
+    if (lhs == rhs) {
+        return AliasResult::MustAlias;
+    }
+    auto lhs_path = access_path(lhs);
+    auto rhs_path = access_path(rhs);
+    if (lhs_path.root != rhs_path.root) {
+        if (is_identified_object(lhs_path.root) && is_identified_object(rhs_path.root)) {
+            return AliasResult::NoAlias;
+        }
+        // A pointer derived from some other value can't point to a local variable whose address never escapes.
+        for (auto *root : {lhs_path.root, rhs_path.root}) {
+            auto *var = root->as_or_null<ir::LocalVar>();
+            if (var != nullptr && escape_kind(var) == EscapeKind::None) {
+                return AliasResult::NoAlias;
+            }
+        }
+        return AliasResult::MayAlias;
+    }
+    if (!lhs_path.exact || !rhs_path.exact) {
+        return AliasResult::MayAlias;
+    }
+    auto length = std::min(lhs_path.indices.size(), rhs_path.indices.size());
+    if (!std::equal(lhs_path.indices.begin(), lhs_path.indices.begin() + length, rhs_path.indices.begin())) {
+        return AliasResult::NoAlias;
+    }
+    return lhs_path.indices.size() == rhs_path.indices.size() ? AliasResult::MustAlias : AliasResult::MayAlias;
+}
+
+EscapeKind AliasAnalysis::escape_kind(ir::LocalVar *var) const {
+    return m_escapes.contains(var) ? m_escapes.at(var) : EscapeKind::Full;
+}
+
+bool AliasAnalysis::may_modify(ir::Instruction *inst, ir::Value *ptr) const {
+    switch (inst->kind()) {
+    case ir::InstKind::Call:
+        return !is_only_locally_writable(ptr);
+    case ir::InstKind::Copy: {
+        auto *dst = inst->as<ir::CopyInst>()->dst();
+        if (is_only_locally_writable(ptr) && access_path(dst).root != access_path(ptr).root) {
+            return false;
+        }
+        return alias(dst, ptr) != AliasResult::NoAlias;
+    }
+    case ir::InstKind::InlineAsm:
+        for (const auto &[output, value] : inst->as<ir::InlineAsmInst>()->outputs()) {
+            if (alias(value, ptr) != AliasResult::NoAlias) {
+                return true;
+            }
+        }
+        return !is_only_locally_writable(ptr);
+    case ir::InstKind::Store: {
+        auto *store_ptr = inst->as<ir::StoreInst>()->ptr();
+        if (is_only_locally_writable(ptr) && access_path(store_ptr).root != access_path(ptr).root) {
+            return false;
+        }
+        return alias(store_ptr, ptr) != AliasResult::NoAlias;
+    }
+    default:
+        return false;
+    }
+}
+
+bool AliasAnalysis::may_reference(ir::Instruction *inst, ir::Value *ptr) const {
+    auto *var = access_path(ptr).root->as_or_null<ir::LocalVar>();
+    bool escapes = var == nullptr || escape_kind(var) != EscapeKind::None;
+    switch (inst->kind()) {
+    case ir::InstKind::Call:
+    case ir::InstKind::InlineAsm:
+        return escapes;
+    case ir::InstKind::Copy:
+        return alias(inst->as<ir::CopyInst>()->src(), ptr) != AliasResult::NoAlias;
+    case ir::InstKind::Load:
+        return alias(inst->as<ir::LoadInst>()->ptr(), ptr) != AliasResult::NoAlias;
+    default:
+        return false;
+    }
+}
+
+ir::Value *AliasAnalysis::underlying_object(ir::Value *ptr) const {
+    return access_path(ptr).root;
+}
+
+void AliasAnalyser::run(ir::Function *function) {
+    auto *aa = m_manager->make<AliasAnalysis>(function);
+    for (auto *var : function->vars()) {
+        aa->m_escapes.emplace(var, escape_kind_of(var));
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <pass/Pass.hh>
+#include <pass/PassResult.hh>
+
+#include <unordered_map>
+
+namespace ir {
+
+class Instruction;
+class LocalVar;
+class Value;
+
+} // namespace ir
+
+struct AliasAnalyser;
+
+enum class AliasResult {
+    NoAlias,
+    MayAlias,
+    MustAlias,
+};
+
+enum class EscapeKind {
+    // The variable's address is only used by loads, stores and leas.
+    None,
+    // Only immutable pointers to the variable escape, so it may be read, but not written, through them.
+    ReadOnly,
+    Full,
+};
+
+class AliasAnalysis : public PassResult {
+    friend AliasAnalyser;
+
+private:
+    std::unordered_map<ir::LocalVar *, EscapeKind> m_escapes;
+
+    bool is_only_locally_writable(ir::Value *ptr) const;
+
+public:
+    using analyser = AliasAnalyser;
+
+    AliasResult alias(ir::Value *lhs, ir::Value *rhs) const;
+    EscapeKind escape_kind(ir::LocalVar *var) const;
+    bool may_modify(ir::Instruction *inst, ir::Value *ptr) const;
+    bool may_reference(ir::Instruction *inst, ir::Value *ptr) const;
+    ir::Value *underlying_object(ir::Value *ptr) const;
+};
+
+struct AliasAnalyser : public Pass {
+    constexpr explicit AliasAnalyser(PassManager *manager) : Pass(manager) {}
+
+    void run(ir::Function *) override;
+};
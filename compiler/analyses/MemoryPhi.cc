@@ -0,0 +1,38 @@
+#include <analyses/MemoryPhi.hh>
+
+#include <ir/BasicBlock.hh>
+#include <support/Assert.hh>
+
+MemoryPhi::~MemoryPhi() {
+    for (auto [block, value] : m_incoming) {
+        ASSERT(block != nullptr);
+        block->remove_user(this);
+        if (value != nullptr) {
+            value->remove_user(this);
+        }
+    }
+}
+
+void MemoryPhi::add_incoming(ir::BasicBlock *block, ir::Value *value) {
+    // TODO: Do we need to add users here?
+    ASSERT(block != nullptr);
+    block->add_user(this);
+    if (value != nullptr) {
+        value->add_user(this);
+    }
+    m_incoming[block] = value;
+}
+
+void MemoryPhi::replace_uses_of_with(Value *orig, Value *repl) {
+    for (auto &[block, value] : m_incoming) {
+        ASSERT(block != orig);
+        if (value == orig) {
+            ASSERT(value != nullptr);
+            value->remove_user(this);
+            if (repl != nullptr) {
+                repl->add_user(this);
+            }
+            value = repl;
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <ir/Value.hh>
+#include <support/ListNode.hh>
+
+#include <unordered_map>
+
+namespace ir {
+
+class BasicBlock;
+
+} // namespace ir
+
+/// @brief A merge of memory definitions at a control flow join.
+/// @details Used by ReachingDefAnalysis, where `var` is the pointer being defined, and by MemorySsaAnalysis, where `var`
+/// is null since all of memory is treated as one variable.
+class MemoryPhi : public ir::Value, public ListNode {
+    ir::Value *const m_var;
+    std::unordered_map<ir::BasicBlock *, ir::Value *> m_incoming;
+
+public:
+    static constexpr auto KIND = ir::ValueKind::MemoryPhi;
+
+    explicit MemoryPhi(ir::Value *var) : ir::Value(KIND), m_var(var) {}
+    ~MemoryPhi() override;
+
+    void add_incoming(ir::BasicBlock *block, ir::Value *value);
+    void replace_uses_of_with(Value *orig, Value *repl) override;
+
+    ir::Value *var() const { return m_var; }
+    const std::unordered_map<ir::BasicBlock *, ir::Value *> &incoming() const { return m_incoming; }
+};
@@ -0,0 +1,139 @@
+#include <analyses/MemorySsaAnalysis.hh>
+
+#include <analyses/AliasAnalysis.hh>
+#include <analyses/ControlFlowAnalysis.hh>
+#include <ir/BasicBlock.hh>
+#include <ir/Function.hh>
+#include <ir/Instructions.hh>
+#include <pass/PassManager.hh>
+#include <pass/PassUsage.hh>
+#include <support/Assert.hh>
+#include <support/Stack.hh>
+
+
+namespace {
+
+bool is_memory_def(const ir::Instruction *inst) {
+    switch (inst->kind()) {
+    case ir::InstKind::Call:
+    case ir::InstKind::Copy:
+    case ir::InstKind::InlineAsm:
+    case ir::InstKind::Store:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+MemorySsaAnalysis::MemorySsaAnalysis(const AliasAnalysis *aa) : m_aa(aa) {
+    m_live_on_entry = create<MemoryDef>(nullptr, nullptr);
+}
+
+ir::Value *MemorySsaAnalysis::walk(ir::Value *access, ir::Value *ptr,
+                                   std::unordered_map<MemoryPhi *, ir::Value *> &visited) const {
+    while (auto *def = access->as_or_null<MemoryDef>()) {
+        if (def->is_live_on_entry() || m_aa->may_modify(def->inst(), ptr)) {
+            return def;
+        }
+        access = def->defining();
+    }
+
+    // A phi is only transparent if every incoming access reaches the same clobber.
+    auto *phi = access->as<MemoryPhi>();
+    if (visited.contains(phi)) {
+        return visited.at(phi);
+    }
+    visited.emplace(phi, phi);
+    ir::Value *clobber = nullptr;
+    for (auto [block, incoming] : phi->incoming()) {
+        auto *incoming_clobber = walk(incoming, ptr, visited);
+        if (clobber != nullptr && incoming_clobber != clobber) {
+            return phi;
+        }
+        clobber = incoming_clobber;
+    }
+    visited[phi] = clobber;
+    return clobber;
+}
+
+ir::Value *MemorySsaAnalysis::clobbering_access(ir::LoadInst *load) const {
+    return clobbering_access(use(load)->defining(), load->ptr());
+}
+
+ir::Value *MemorySsaAnalysis::clobbering_access(ir::Value *access, ir::Value *ptr) const {
+    std::unordered_map<MemoryPhi *, ir::Value *> visited;
+    return walk(access, ptr, visited);
+}
+
+MemoryDef *MemorySsaAnalysis::def(ir::Instruction *inst) const {
+    return m_defs.at(inst);
+}
+
+MemoryPhi *MemorySsaAnalysis::phi(ir::BasicBlock *block) const {
+    return m_phis.contains(block) ? m_phis.at(block) : nullptr;
+}
+
+MemoryUse *MemorySsaAnalysis::use(ir::LoadInst *load) const {
+    return m_uses.at(load);
+}
+
+void MemorySsaAnalyser::rename(ir::BasicBlock *block, ir::Value *current, const ControlFlowAnalysis *cfa,
+                               MemorySsaAnalysis *mssa) {
+    if (auto *phi = mssa->phi(block)) {
+        current = phi;
+    }
+    for (auto *inst : *block) {
+        if (auto *load = inst->as_or_null<ir::LoadInst>()) {
+            mssa->m_uses.emplace(load, mssa->create<MemoryUse>(load, current));
+        } else if (is_memory_def(inst)) {
+            auto *def = mssa->create<MemoryDef>(inst, current);
+            mssa->m_defs.emplace(inst, def);
+            current = def;
+        }
+    }
+    for (auto *succ : cfa->succs(block)) {
+        if (auto *phi = mssa->phi(succ)) {
+            phi->add_incoming(block, current);
+        }
+    }
+    for (auto *dominatee : cfa->dominatees(block)) {
+        rename(dominatee, current, cfa, mssa);
+    }
+}
+
+void MemorySsaAnalyser::build_usage(PassUsage *usage) {
+    usage->uses<AliasAnalysis>();
+    usage->uses<ControlFlowAnalysis>();
+}
+
+void MemorySsaAnalyser::run(ir::Function *function) {
+    if (function->begin() == function->end()) {
+        return;
+    }
+
+    auto *cfa = m_manager->get<ControlFlowAnalysis>(function);
+    auto *mssa = m_manager->make<MemorySsaAnalysis>(function, m_manager->get<AliasAnalysis>(function));
+    Stack<ir::BasicBlock *> work_list;
+    for (auto *block : *function) {
+        for (auto *inst : *block) {
+            if (is_memory_def(inst)) {
+                work_list.push(block);
+                break;
+            }
+        }
+    }
+
+    // Place phis on the iterated dominance frontier of every block containing a def.
+    while (!work_list.empty()) {
+        auto *block = work_list.pop();
+        for (auto *df : cfa->frontiers(block)) {
+            if (!mssa->m_phis.contains(df)) {
+                mssa->m_phis.emplace(df, mssa->create<MemoryPhi>(nullptr));
+                work_list.push(df);
+            }
+        }
+    }
+    rename(cfa->entry(), mssa->live_on_entry(), cfa, mssa);
+}
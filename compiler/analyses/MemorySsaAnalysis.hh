@@ -0,0 +1,102 @@
+#pragma once
+
+#include <analyses/MemoryPhi.hh>
+#include <ir/Value.hh>
+#include <pass/Pass.hh>
+#include <pass/PassResult.hh>
+#include <support/Box.hh>
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ir {
+
+class BasicBlock;
+class Instruction;
+class LoadInst;
+
+} // namespace ir
+
+class AliasAnalysis;
+class ControlFlowAnalysis;
+class MemorySsaAnalyser;
+
+/// @brief An instruction which may write to memory, or the state of memory on function entry.
+class MemoryDef : public ir::Value {
+    ir::Instruction *const m_inst;
+    ir::Value *const m_defining;
+
+public:
+    static constexpr auto KIND = ir::ValueKind::MemoryDef;
+
+    MemoryDef(ir::Instruction *inst, ir::Value *defining) : ir::Value(KIND), m_inst(inst), m_defining(defining) {}
+
+    bool is_live_on_entry() const { return m_inst == nullptr; }
+    ir::Instruction *inst() const { return m_inst; }
+    ir::Value *defining() const { return m_defining; }
+};
+
+/// @brief A load, which reads the memory state of its defining access.
+class MemoryUse : public ir::Value {
+    ir::LoadInst *const m_load;
+    ir::Value *const m_defining;
+
+public:
+    static constexpr auto KIND = ir::ValueKind::MemoryUse;
+
+    MemoryUse(ir::LoadInst *load, ir::Value *defining) : ir::Value(KIND), m_load(load), m_defining(defining) {}
+
+    ir::LoadInst *load() const { return m_load; }
+    ir::Value *defining() const { return m_defining; }
+};
+
+/// @brief Memory SSA form of a function, where all of memory is treated as a single variable.
+/// @details Defining accesses are MemoryDefs or MemoryPhis. Every def is chained to the previous def, so finding the
+/// instruction that actually clobbers a particular pointer requires walking the chain with alias analysis.
+class MemorySsaAnalysis : public PassResult {
+    friend MemorySsaAnalyser;
+
+private:
+    const AliasAnalysis *const m_aa;
+    std::vector<Box<ir::Value>> m_accesses;
+    MemoryDef *m_live_on_entry;
+    std::unordered_map<ir::BasicBlock *, MemoryPhi *> m_phis;
+    std::unordered_map<ir::Instruction *, MemoryDef *> m_defs;
+    std::unordered_map<ir::LoadInst *, MemoryUse *> m_uses;
+
+    template <typename T, typename... Args>
+    T *create(Args &&... args);
+
+    ir::Value *walk(ir::Value *access, ir::Value *ptr, std::unordered_map<MemoryPhi *, ir::Value *> &visited) const;
+
+public:
+    using analyser = MemorySsaAnalyser;
+
+    explicit MemorySsaAnalysis(const AliasAnalysis *aa);
+
+    ir::Value *clobbering_access(ir::LoadInst *load) const;
+    ir::Value *clobbering_access(ir::Value *access, ir::Value *ptr) const;
+
+    MemoryDef *def(ir::Instruction *inst) const;
+    MemoryPhi *phi(ir::BasicBlock *block) const;
+    MemoryUse *use(ir::LoadInst *load) const;
+    MemoryDef *live_on_entry() const { return m_live_on_entry; }
+};
+
+template <typename T, typename... Args>
+T *MemorySsaAnalysis::create(Args &&... args) {
+    auto *access = new T(std::forward<Args>(args)...);
+    m_accesses.emplace_back(access);
+    return access;
+}
+
+class MemorySsaAnalyser : public Pass {
+    void rename(ir::BasicBlock *block, ir::Value *current, const ControlFlowAnalysis *cfa, MemorySsaAnalysis *mssa);
+
+public:
+    constexpr explicit MemorySsaAnalyser(PassManager *manager) : Pass(manager) {}
+
+    void build_usage(PassUsage *) override;
+    void run(ir::Function *) override;
+};
@@ -1,10 +1,11 @@
 #pragma once
 
+#include <analyses/MemoryPhi.hh>
 #include <ir/Value.hh>
 #include <pass/Pass.hh>
 #include <pass/PassResult.hh>
 #include <support/List.hh>
-#include <support/ListNode.hh>
+#include <support/Stack.hh>
 
 #include <unordered_map>
 #include <vector>
@@ -16,24 +17,8 @@ class LoadInst;
 
 } // namespace ir
 
-struct ReachingDefAnalyser;
-
-class MemoryPhi : public ir::Value, public ListNode {
-    ir::Value *const m_var;
-    std::unordered_map<ir::BasicBlock *, ir::Value *> m_incoming;
-
-public:
-    static constexpr auto KIND = ir::ValueKind::MemoryPhi;
-
-    explicit MemoryPhi(ir::Value *var) : ir::Value(KIND), m_var(var) {}
-    ~MemoryPhi() override;
-
-    void add_incoming(ir::BasicBlock *block, ir::Value *value);
-    void replace_uses_of_with(Value *orig, Value *repl) override;
-
-    ir::Value *var() const { return m_var; }
-    const std::unordered_map<ir::BasicBlock *, ir::Value *> &incoming() const { return m_incoming; }
-};
+class ControlFlowAnalysis;
+class ReachingDefAnalyser;
 
 class ReachingDefAnalysis : public PassResult {
     friend ReachingDefAnalyser;
@@ -52,7 +37,11 @@ public:
     std::vector<ir::Value *> reaching_values(ir::LoadInst *load) const;
 };
 
-struct ReachingDefAnalyser : public Pass {
+class ReachingDefAnalyser : public Pass {
+    void rename(ir::BasicBlock *block, const ControlFlowAnalysis *cfa, ReachingDefAnalysis *rda,
+                std::unordered_map<ir::Value *, Stack<ir::Value *>> &def_stacks);
+
+public:
     constexpr explicit ReachingDefAnalyser(PassManager *manager) : Pass(manager) {}
 
     void build_usage(PassUsage *) override;
@@ -293,6 +293,7 @@ public:
 
 class Root : public Node {
     List<const Node> m_decls;
+    std::string m_path;
 
 public:
     static constexpr auto KIND = NodeKind::Root;
@@ -300,6 +301,7 @@ public:
     Root() : Node(KIND, 0) {}
 
     void add(const Node *decl) { m_decls.insert(m_decls.end(), decl); }
+    void set_path(std::string path) { m_path = std::move(path); }
 
     template <typename T, typename... Args>
     T *add(Args &&... args) {
@@ -307,6 +309,7 @@ public:
     }
 
     const List<const Node> &decls() const { return m_decls; }
+    const std::string &path() const { return m_path; }
 };
 
 class StringLit : public Node {
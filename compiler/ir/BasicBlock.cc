@@ -10,6 +10,14 @@ BasicBlock::iterator BasicBlock::position(Instruction *inst) const {
     return BasicBlock::iterator(inst);
 }
 
+void BasicBlock::splice(iterator position, BasicBlock *block) {
+    ASSERT(block != this);
+    for (auto *inst : *block) {
+        inst->set_parent(this);
+    }
+    m_instructions.splice(position, block->m_instructions);
+}
+
 BasicBlock::iterator BasicBlock::remove(Instruction *inst) {
     ASSERT(inst->users().empty());
     auto it = position(inst);
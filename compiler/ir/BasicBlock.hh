@@ -57,6 +57,12 @@ public:
 
     iterator position(Instruction *inst) const;
 
+    /// @brief Moves all instructions of `block` before `position`.
+    /// @details The moved instructions are reparented to this block, leaving `block` empty.
+    /// @param position The position to move the instructions before.
+    /// @param block The block to move the instructions from.
+    void splice(iterator position, BasicBlock *block);
+
     /// @return The iterator of the next instruction.
     iterator remove(Instruction *inst);
 
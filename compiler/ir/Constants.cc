@@ -16,7 +16,8 @@ namespace {
 std::vector<Box<ConstantArray>> s_constant_arrays;
 std::unordered_map<std::pair<const Type *, std::size_t>, ConstantInt, PairHash> s_constant_ints;
 std::unordered_map<const Type *, ConstantNull> s_constant_nulls;
-std::unordered_map<std::string, ConstantString> s_constant_strings;
+// Keyed by type as well, since the type is owned by the program the string was first created for.
+std::unordered_map<std::pair<const Type *, std::string>, ConstantString, PairHash> s_constant_strings;
 std::unordered_map<const Type *, Undef> s_undefs;
 
 } // namespace
@@ -55,12 +56,13 @@ ConstantNull *ConstantNull::get(const Type *type) {
 }
 
 ConstantString *ConstantString::get(const Program *program, std::string value) {
-    if (!s_constant_strings.contains(value)) {
-        s_constant_strings.emplace(
-            std::piecewise_construct, std::forward_as_tuple(value),
-            std::forward_as_tuple(program->pointer_type(program->int_type(8, false), false), value));
+    const auto *type = program->pointer_type(program->int_type(8, false), false);
+    std::pair<const Type *, std::string> pair(type, std::move(value));
+    if (!s_constant_strings.contains(pair)) {
+        s_constant_strings.emplace(std::piecewise_construct, std::forward_as_tuple(pair),
+                                   std::forward_as_tuple(type, pair.second));
     }
-    return &s_constant_strings.at(value);
+    return &s_constant_strings.at(pair);
 }
 
 Undef *Undef::get(const Type *type) {
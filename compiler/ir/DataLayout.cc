@@ -0,0 +1,78 @@
+#include <ir/DataLayout.hh>
+
+#include <ir/Types.hh>
+
+#include <algorithm>
+
+namespace ir {
+namespace {
+
+std::size_t align_to(std::size_t value, std::size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+} // namespace
+
+std::size_t align_of(const Type *type) {
+    switch (type->kind()) {
+    case TypeKind::Alias:
+        return align_of(type->as<AliasType>()->aliased());
+    case TypeKind::Array:
+        return align_of(type->as<ArrayType>()->element_type());
+    case TypeKind::Int:
+        return type->as<IntType>()->size_in_bytes();
+    case TypeKind::Function:
+    case TypeKind::Pointer:
+        return 8;
+    case TypeKind::Struct: {
+        std::size_t align = 1;
+        for (const auto &field : type->as<StructType>()->fields()) {
+            align = std::max(align, align_of(field.type()));
+        }
+        return align;
+    }
+    default:
+        return 1;
+    }
+}
+
+std::size_t size_of(const Type *type) {
+    switch (type->kind()) {
+    case TypeKind::Alias:
+        return size_of(type->as<AliasType>()->aliased());
+    case TypeKind::Array: {
+        const auto *array_type = type->as<ArrayType>();
+        return size_of(array_type->element_type()) * array_type->length();
+    }
+    case TypeKind::Int:
+        return type->as<IntType>()->size_in_bytes();
+    case TypeKind::Function:
+    case TypeKind::Pointer:
+        return 8;
+    case TypeKind::Struct: {
+        std::size_t size = 0;
+        for (const auto &field : type->as<StructType>()->fields()) {
+            size = align_to(size, align_of(field.type())) + size_of(field.type());
+        }
+        return align_to(size, align_of(type));
+    }
+    case TypeKind::Void:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+std::size_t field_offset(const StructType *struct_type, std::size_t index) {
+    std::size_t offset = 0;
+    for (std::size_t i = 0; const auto &field : struct_type->fields()) {
+        offset = align_to(offset, align_of(field.type()));
+        if (i++ == index) {
+            break;
+        }
+        offset += size_of(field.type());
+    }
+    return offset;
+}
+
+} // namespace ir
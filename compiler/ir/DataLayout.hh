@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace ir {
+
+class StructType;
+class Type;
+
+// The natural x86-64 layout of types, matching what LLVM picks for the equivalent LLVM types. Pointers to void and
+// traits are treated like pointers to bytes.
+std::size_t align_of(const Type *type);
+std::size_t size_of(const Type *type);
+std::size_t field_offset(const StructType *struct_type, std::size_t index);
+
+} // namespace ir
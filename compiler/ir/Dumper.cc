@@ -163,7 +163,8 @@ void DumperVisitor::dump(const Function *function) {
 void DumperVisitor::dump(const GlobalVariable *global) {
     // TODO: Print @gn on unnamed global.
     ASSERT(global->has_name());
-    fmt::print("const @{} = {}\n", global->name(), printable_value(global->initialiser(), true));
+    fmt::print("{} @{} = {}\n", global->is_mutable() ? "var" : "const", global->name(),
+               printable_value(global->initialiser(), true));
 }
 
 void DumperVisitor::visit(BinaryInst *binary) {
@@ -52,11 +52,22 @@ void Function::remove_arg(Argument *arg) {
     m_args.erase(ListIterator<Argument>(arg));
 }
 
+void Function::remove_block(BasicBlock *block) {
+    ASSERT(block->users().empty());
+    ASSERT(block != entry());
+    m_blocks.erase(ListIterator<BasicBlock>(block));
+}
+
 void Function::remove_var(LocalVar *var) {
     ASSERT(var->users().empty());
     m_vars.erase(ListIterator<LocalVar>(var));
 }
 
+void Function::set_location(std::string file, int line) {
+    m_file = std::move(file);
+    m_line = line;
+}
+
 BasicBlock *Function::entry() const {
     ASSERT(!m_blocks.empty());
     return *m_blocks.begin();
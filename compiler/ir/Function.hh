@@ -44,6 +44,8 @@ class Function : public Value, public ListNode {
     List<Argument> m_args;
     List<LocalVar> m_vars;
     List<BasicBlock> m_blocks;
+    std::string m_file;
+    int m_line{-1};
 
 public:
     static constexpr auto KIND = ValueKind::Function;
@@ -64,7 +66,9 @@ public:
     BasicBlock *append_block();
     LocalVar *append_var(const Type *type, bool is_mutable);
     void remove_arg(Argument *arg);
+    void remove_block(BasicBlock *block);
     void remove_var(LocalVar *var);
+    void set_location(std::string file, int line);
 
     Prototype *prototype() const { return m_prototype; }
     const List<Argument> &args() const { return m_args; }
@@ -72,6 +76,8 @@ public:
     BasicBlock *entry() const;
     const FunctionType *function_type() const;
     const Type *return_type() const;
+    const std::string &file() const { return m_file; }
+    int line() const { return m_line; }
 };
 
 } // namespace ir
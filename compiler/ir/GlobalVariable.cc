@@ -4,7 +4,8 @@
 
 namespace ir {
 
-GlobalVariable::GlobalVariable(const ir::Constant *initialiser) : Value(KIND), m_initialiser(initialiser) {
+GlobalVariable::GlobalVariable(const ir::Constant *initialiser, bool is_mutable)
+    : Value(KIND), m_initialiser(initialiser), m_is_mutable(is_mutable) {
     ASSERT(m_initialiser != nullptr);
     set_type(initialiser->type());
 }
@@ -8,11 +8,12 @@ namespace ir {
 
 class GlobalVariable : public Value, public ListNode {
     const ir::Constant *const m_initialiser;
+    const bool m_is_mutable;
 
 public:
     static constexpr auto KIND = ValueKind::GlobalVariable;
 
-    explicit GlobalVariable(const ir::Constant *initialiser);
+    explicit GlobalVariable(const ir::Constant *initialiser, bool is_mutable = false);
     GlobalVariable(const GlobalVariable &) = delete;
     GlobalVariable(GlobalVariable &&) = delete;
     ~GlobalVariable() override = default;
@@ -21,6 +22,7 @@ public:
     GlobalVariable &operator=(GlobalVariable &&) = delete;
 
     const ir::Constant *initialiser() const { return m_initialiser; }
+    bool is_mutable() const { return m_is_mutable; }
 };
 
 } // namespace ir
@@ -14,4 +14,8 @@ void Instruction::set_line(int line) {
     m_line = line;
 }
 
+void Instruction::set_parent(BasicBlock *parent) {
+    m_parent = parent;
+}
+
 } // namespace ir
@@ -35,7 +35,7 @@ enum class InstKind {
 
 class Instruction : public Value, public ListNode {
     const InstKind m_kind;
-    BasicBlock *const m_parent;
+    BasicBlock *m_parent;
     int m_line{-1};
 
 protected:
@@ -59,6 +59,7 @@ public:
     ListIterator<Instruction> remove_from_parent();
 
     void set_line(int line);
+    void set_parent(BasicBlock *parent);
 
     InstKind kind() const { return m_kind; }
     BasicBlock *parent() const { return m_parent; }
@@ -330,9 +330,14 @@ void PhiInst::add_incoming(BasicBlock *block, Value *value) {
     m_incoming[block] = value;
 }
 
-void PhiInst::remove_incoming(BasicBlock *) {
-    // TODO: Implement.
-    ENSURE_NOT_REACHED();
+void PhiInst::remove_incoming(BasicBlock *block) {
+    ASSERT(m_incoming.contains(block));
+    auto *value = m_incoming.at(block);
+    block->remove_user(this);
+    if (value != nullptr) {
+        value->remove_user(this);
+    }
+    m_incoming.erase(block);
 }
 
 void PhiInst::replace_uses_of_with(Value *orig, Value *repl) {
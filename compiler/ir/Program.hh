@@ -3,6 +3,7 @@
 #include <ir/Function.hh>
 #include <ir/GlobalVariable.hh>
 #include <ir/TypeCache.hh>
+#include <support/Assert.hh>
 #include <support/List.hh>
 
 #include <string>
@@ -33,6 +34,13 @@ public:
 
     void append_prototype(Prototype *prototype) { return m_prototypes.insert(m_prototypes.end(), prototype); }
 
+    /// @brief Destroys `function`. Any remaining uses of it are replaced with null, so must also be destroyed.
+    void remove_function(Function *function) { m_functions.erase(ListIterator<Function>(function)); }
+    void remove_global(GlobalVariable *global) {
+        ASSERT(global->users().empty());
+        m_globals.erase(ListIterator<GlobalVariable>(global));
+    }
+
     template <typename Ty, typename... Args>
     Ty *make(Args &&... args) requires std::derived_from<Ty, Type> {
         return static_cast<Ty *>(*m_types.emplace_back(new Ty(this, std::forward<Args>(args)...)));
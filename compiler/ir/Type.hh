@@ -44,7 +44,6 @@ public:
     Type &operator=(Type &&) = delete;
 
     virtual bool equals_weak(const Type *other) const;
-    virtual int size_in_bytes() const;
     virtual std::string to_string() const = 0;
 
     const TypeCache *cache() const { return m_cache; }
@@ -63,10 +63,6 @@ bool Type::equals_weak(const Type *other) const {
     return other == this;
 }
 
-int Type::size_in_bytes() const {
-    ENSURE_NOT_REACHED();
-}
-
 std::string InvalidType::to_string() const {
     return "invalid";
 }
@@ -118,14 +114,6 @@ std::string PointerType::to_string() const {
     return std::move(ret);
 }
 
-int StructType::size_in_bytes() const {
-    int size = 0;
-    for (const auto &field : m_fields) {
-        size += field.type()->size_in_bytes();
-    }
-    return size;
-}
-
 std::string StructType::to_string() const {
     std::string ret = "struct(";
     for (bool first = true; const auto *implementing : m_implementing) {
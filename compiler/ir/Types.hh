@@ -85,9 +85,9 @@ public:
     IntType(const TypeCache *cache, int bit_width, bool is_signed)
         : Type(cache, KIND), m_bit_width(bit_width), m_is_signed(is_signed) {}
 
-    int size_in_bytes() const override;
     std::string to_string() const override;
 
+    int size_in_bytes() const;
     int bit_width() const { return m_bit_width; }
     bool is_signed() const { return m_is_signed; }
 };
@@ -135,7 +135,6 @@ public:
     void add_field(const std::string &name, const Type *type) { m_fields.emplace_back(name, type); };
     void add_implementing(const Type *type) { m_implementing.push_back(type); }
     void add_prototype(Prototype *prototype) const { m_prototypes.insert(m_prototypes.end(), prototype); }
-    int size_in_bytes() const override;
     std::string to_string() const override;
 
     const std::vector<StructField> &fields() const { return m_fields; }
@@ -17,7 +17,9 @@ enum class ValueKind {
     GlobalVariable,
     Instruction,
     LocalVar,
+    MemoryDef,
     MemoryPhi,
+    MemoryUse,
     Prototype,
 };
 
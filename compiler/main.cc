@@ -1,6 +1,22 @@
+#include <CfgSimplifier.hh>
 #include <Compiler.hh>
 #include <ConcreteImplementer.hh>
+#include <ConstantPropagator.hh>
+#include <DeadCodeEliminator.hh>
+#include <DeadFunctionEliminator.hh>
+#include <DeadStoreEliminator.hh>
+#include <FastBackend.hh>
+#include <GlobalValueNumberer.hh>
+#include <IncrementalBuild.hh>
+#include <Interpreter.hh>
 #include <LLVMGen.hh>
+#include <ObjectCache.hh>
+#include <ObjectEmitter.hh>
+#include <PerfMap.hh>
+#include <Profile.hh>
+#include <ProfileInstrumenter.hh>
+#include <Remarks.hh>
+#include <Server.hh>
 #include <StackPromoter.hh>
 #include <TypeChecker.hh>
 #include <VarChecker.hh>
@@ -10,89 +26,708 @@
 #include <support/Box.hh>
 #include <support/Error.hh>
 
-#include <llvm/ExecutionEngine/MCJIT.h>
+#include <fmt/core.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/ExecutionEngine/SectionMemoryManager.h>
 #include <llvm/IR/LLVMContext.h>
-#include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
-int main(int argc, char **argv) {
+#include <sys/resource.h>
+
+namespace {
+
+// Returns the features of the host CPU in the form taken by target machines, e.g. "+avx2,-avx512f".
+std::string host_cpu_features() {
+    llvm::SubtargetFeatures features;
+    llvm::StringMap<bool> host_features;
+    if (llvm::sys::getHostCPUFeatures(host_features)) {
+        for (const auto &feature : host_features) {
+            features.AddFeature(feature.getKey(), feature.getValue());
+        }
+    }
+    return features.getString();
+}
+
+// Creates an object linking layer which notifies `listeners` of every object it loads.
+template <typename Builder>
+void set_object_linking_layer(Builder &builder, const std::vector<llvm::JITEventListener *> &listeners) {
+    if (listeners.empty()) {
+        return;
+    }
+    builder.setObjectLinkingLayerCreator([listeners](llvm::orc::ExecutionSession &session, const llvm::Triple &) {
+        auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(session, [] {
+            return std::make_unique<llvm::SectionMemoryManager>();
+        });
+        for (auto *listener : listeners) {
+            layer->registerJITEventListener(*listener);
+        }
+        return std::unique_ptr<llvm::orc::ObjectLayer>(std::move(layer));
+    });
+}
+
+// Creates a JIT which compiles functions lazily, or, when there is an object cache, one which compiles the whole module
+// at once so that a complete object can be cached.
+std::unique_ptr<llvm::orc::LLJIT> create_jit(ObjectCache *object_cache, llvm::orc::JITTargetMachineBuilder machine_builder,
+                                             const std::vector<llvm::JITEventListener *> &listeners) {
+    if (object_cache == nullptr) {
+        llvm::orc::LLLazyJITBuilder builder;
+        builder.setJITTargetMachineBuilder(std::move(machine_builder));
+        set_object_linking_layer(builder, listeners);
+        return llvm::cantFail(builder.create());
+    }
+    llvm::orc::LLJITBuilder builder;
+    builder.setJITTargetMachineBuilder(std::move(machine_builder));
+    set_object_linking_layer(builder, listeners);
+    builder.setCompileFunctionCreator([object_cache](llvm::orc::JITTargetMachineBuilder machine_builder)
+                                          -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+        auto machine = machine_builder.createTargetMachine();
+        if (!machine) {
+            return machine.takeError();
+        }
+        return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*machine), object_cache);
+    });
+    return llvm::cantFail(builder.create());
+}
+
+// Prints how long a phase of compilation took since `start`, for --print-stats.
+void print_phase_time(const char *phase, std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+    fmt::print("{} took {:.2f} ms\n", phase, time.count());
+}
+
+// Removes the out.N.o objects left behind by an earlier build which produced more objects than the current one, so that
+// linking out*.o doesn't pick them up.
+void remove_stale_objects(std::size_t object_count) {
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(".", ec)) {
+        // Only names which could have been written by a build are considered, e.g. not out.01.o.
+        auto name = entry.path().filename().string();
+        std::size_t index = 0;
+        if (name.size() <= 6 || !name.starts_with("out.") ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), index).ec != std::errc()) {
+            continue;
+        }
+        if (index >= object_count && name == fmt::format("out.{}.o", index)) {
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+}
+
+// Adds the passes which check and optimise every program.
+void add_common_passes(PassManager &pass_manager, bool print_stats) {
+    pass_manager.add<TypeChecker>();
+    pass_manager.add<VarChecker>();
+    pass_manager.add<ConcreteImplementer>();
+    pass_manager.add<StackPromoter>();
+    pass_manager.add<GlobalValueNumberer>();
+    pass_manager.add<ConstantPropagator>();
+    pass_manager.add<DeadStoreEliminator>(print_stats);
+    pass_manager.add<DeadCodeEliminator>();
+    pass_manager.add<CfgSimplifier>();
+}
+
+// Checks that `cpu` is a CPU model known to the host target. LLVM only warns about unknown models, and then fails in
+// confusing ways once it generates code for one.
+void check_target_cpu(const std::string &cpu) {
+    llvm::InitializeNativeTarget();
+    auto triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const auto *target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) {
+        print_error_and_abort("{}", error);
+    }
+    std::unique_ptr<llvm::MCSubtargetInfo> subtarget_info(target->createMCSubtargetInfo(triple, "", ""));
+    if (!subtarget_info->isCPUStringValid(cpu)) {
+        print_error_and_abort("unknown target CPU '{}'", cpu);
+    }
+}
+
+// Returns a function creating target machines which generate objects for the host OS.
+std::function<std::unique_ptr<llvm::TargetMachine>()> target_machine_creator(const std::string &cpu,
+                                                                             const std::string &features) {
+    auto triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const auto *target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (target == nullptr) {
+        print_error_and_abort("{}", error);
+    }
+    return [=] {
+        llvm::TargetOptions options;
+        return std::unique_ptr<llvm::TargetMachine>(
+            target->createTargetMachine(triple, cpu, features, options, llvm::Reloc::DynamicNoPIC));
+    };
+}
+
+// Builds each of `input_files` to its own object in `output_dir`, named after the input. Programs are parsed and lowered
+// one at a time, since IR constants are shared between programs, while objects are generated on `thread_count` threads.
+// A program failing to compile doesn't stop the others from being built.
+int build_many(const std::vector<std::string> &input_files, const std::filesystem::path &output_dir,
+               ParseCache &parse_cache, bool freestanding, const LLVMGenOptions &llvm_gen_options,
+               const std::function<std::unique_ptr<llvm::TargetMachine>()> &create_machine, unsigned thread_count,
+               bool print_stats) {
+    std::vector<std::filesystem::path> output_paths;
+    std::unordered_set<std::string> output_names;
+    for (const auto &input_file : input_files) {
+        auto output_path = output_dir / std::filesystem::path(input_file).filename().replace_extension(".o");
+        if (!output_names.insert(output_path.string()).second) {
+            print_error_and_abort("More than one input would be built to {}", output_path.string());
+        }
+        output_paths.push_back(std::move(output_path));
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(output_dir, ec);
+
+    // Lowered modules are passed to the codegen threads through a bounded queue, so that only a few are held in memory
+    // at once.
+    struct Job {
+        std::size_t index;
+        std::unique_ptr<llvm::LLVMContext> context;
+        std::unique_ptr<llvm::Module> module;
+    };
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Job> queue;
+    bool done = false;
+    auto worker = [&] {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [&] {
+                    return !queue.empty() || done;
+                });
+                if (queue.empty()) {
+                    return;
+                }
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            condition.notify_all();
+            auto object = emit_object(*job.module, *create_machine());
+            std::ofstream output(output_paths[job.index], std::ios::binary);
+            output.write(object->getBufferStart(), static_cast<std::streamsize>(object->getBufferSize()));
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < thread_count; i++) {
+        threads.emplace_back(worker);
+    }
+
+    // Diagnostics are collected per program so that they can be attributed to their input.
+    auto *outer_diagnostics = g_diagnostics;
+    std::size_t failed_count = 0;
+    for (std::size_t i = 0; i < input_files.size(); i++) {
+        std::string diagnostics;
+        g_error = false;
+        g_diagnostics = &diagnostics;
+        auto context = std::make_unique<llvm::LLVMContext>();
+        std::unique_ptr<llvm::Module> module;
+        try {
+            Compiler compiler(&parse_cache);
+            compiler.parse(input_files[i], freestanding);
+            auto program = compiler.compile();
+            PassManager pass_manager;
+            add_common_passes(pass_manager, print_stats);
+            pass_manager.add<DeadFunctionEliminator>(print_stats);
+            pass_manager.run(*program);
+            abort_if_error();
+            module = gen_llvm(*program, context.get(), llvm_gen_options);
+        } catch (const CompilationAborted &) {
+            failed_count++;
+        }
+        g_diagnostics = outer_diagnostics;
+        if (!diagnostics.empty()) {
+            print_diagnostic(fmt::format("{}:\n{}", input_files[i], diagnostics));
+        }
+        if (!module) {
+            continue;
+        }
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [&] {
+                return queue.size() < 2 * thread_count;
+            });
+            queue.push_back({i, std::move(context), std::move(module)});
+        }
+        condition.notify_all();
+    }
+    {
+        std::lock_guard lock(mutex);
+        done = true;
+    }
+    condition.notify_all();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    g_error = failed_count != 0;
+    if (print_stats) {
+        fmt::print("build-many: built {} of {} programs using {} threads\n", input_files.size() - failed_count,
+                   input_files.size(), thread_count);
+    }
+    return failed_count != 0 ? 1 : 0;
+}
+
+// Runs kodoc with the given command line, either directly or, with a non-null `server`, on behalf of a client of
+// `kodoc serve`.
+int kodoc_main(int argc, char **argv, ServerState *server) {
+    auto start_time = std::chrono::steady_clock::now();
     args::Parser args_parser;
+    args::Value<bool> debug_info_opt(false);
+    args::Value<bool> discard_value_names_opt(false);
     args::Value<bool> dump_ast_opt(false);
     args::Value<bool> dump_ir_opt(false);
     args::Value<bool> dump_llvm_opt(false);
+    args::Value<bool> frame_pointers_opt(false);
     args::Value<bool> freestanding(false);
+    args::Value<bool> interpret_opt(false);
+    args::Value<bool> jitdump_opt(false);
+    args::Value<bool> perf_map_opt(false);
+    args::Value<bool> print_stats_opt(false);
+    args::Value<bool> profile_generate_opt(false);
     args::Value<bool> verify_llvm_opt(true);
+    args::Value<std::string> backend_opt("llvm");
+    args::Value<std::string> cache_dir_opt("");
+    args::Value<std::string> codegen_threads_opt("1");
+    args::Value<std::string> incremental_opt("");
+    args::Value<std::string> march_opt("");
+    args::Value<std::string> output_dir_opt(".");
+    args::Value<std::string> profile_use_opt("");
+    args::Value<std::string> remarks_opt("");
+    args::Value<std::string> remarks_format_opt("yaml");
+    args::Value<std::string> server_opt("");
+    args::Value<std::string> target_cpu_opt("");
+    args::Value<std::string> target_features_opt("");
     std::string mode_string;
     std::string input_file;
+    std::vector<std::string> extra_input_files;
     args_parser.add_arg(&mode_string);
     args_parser.add_arg(&input_file);
+    args_parser.add_rest_args(&extra_input_files);
+    args_parser.add_option("backend", &backend_opt);
+    args_parser.add_option("cache-dir", &cache_dir_opt);
+    args_parser.add_option("codegen-threads", &codegen_threads_opt);
+    args_parser.add_option("discard-value-names", &discard_value_names_opt);
     args_parser.add_option("dump-ast", &dump_ast_opt);
     args_parser.add_option("dump-ir", &dump_ir_opt);
     args_parser.add_option("dump-llvm", &dump_llvm_opt);
+    args_parser.add_option("frame-pointers", &frame_pointers_opt);
     args_parser.add_option("freestanding", &freestanding);
+    args_parser.add_option("g", &debug_info_opt);
+    args_parser.add_option("incremental", &incremental_opt);
+    args_parser.add_option("interpret", &interpret_opt);
+    args_parser.add_option("jitdump", &jitdump_opt);
+    args_parser.add_option("march", &march_opt);
+    args_parser.add_option("o", &output_dir_opt);
+    args_parser.add_option("perf-map", &perf_map_opt);
+    args_parser.add_option("print-stats", &print_stats_opt);
+    args_parser.add_option("profile-generate", &profile_generate_opt);
+    args_parser.add_option("profile-use", &profile_use_opt);
+    args_parser.add_option("remarks-format", &remarks_format_opt);
+    args_parser.add_option("remarks", &remarks_opt);
+    args_parser.add_option("server", &server_opt);
+    args_parser.add_option("target-cpu", &target_cpu_opt);
+    args_parser.add_option("target-features", &target_features_opt);
     args_parser.add_option("verify-llvm", &verify_llvm_opt);
     args_parser.parse(argc, argv);
 
+    // With --server, everything else is done by the server listening on the given socket.
+    if (!server_opt.value().empty() && server == nullptr) {
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; i++) {
+            if (!std::string_view(argv[i]).starts_with("--server")) {
+                args.emplace_back(argv[i]);
+            }
+        }
+        return forward_to_server(server_opt.value(), args);
+    }
+
+    // `kodoc serve <socket>` compiles on behalf of clients passing --server, keeping initialised LLVM targets and
+    // parsed standard library files around between requests. The standard library is parsed by the server itself
+    // before each request, since requests are handled in forked children whose changes to the cache are lost.
+    if (mode_string == "serve") {
+        if (server != nullptr) {
+            throw std::runtime_error("A server can't serve other servers");
+        }
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmParser();
+        llvm::InitializeNativeTargetAsmPrinter();
+        ServerState state;
+        auto prepare_request = [&state] {
+            parse_std_library(state.parse_cache);
+        };
+        return serve(input_file, prepare_request, [&state, argv](const std::vector<std::string> &args) {
+            std::vector<char *> request_argv{argv[0]};
+            for (const auto &arg : args) {
+                request_argv.push_back(const_cast<char *>(arg.c_str()));
+            }
+            return kodoc_main(static_cast<int>(request_argv.size()), request_argv.data(), &state);
+        });
+    }
+
+    // `kodoc remarks <file>` summarises a file written by --remarks.
+    if (mode_string == "remarks") {
+        return print_remark_summary(input_file);
+    }
     bool run = mode_string == "run";
-    if (mode_string != "build" && mode_string != "run") {
+    bool many = mode_string == "build-many";
+    if (mode_string != "build" && mode_string != "run" && !many) {
         throw std::runtime_error("Invalid mode " + mode_string);
     }
+    if (!many && !extra_input_files.empty()) {
+        throw std::runtime_error("Invalid number of args passed");
+    }
+    bool interpret_program = run && interpret_opt.present_or_true();
 
-    Compiler compiler;
-    auto program = compiler.compile(input_file, freestanding.present_or_true());
+    // A server runs programs in a child process, since they may exit or crash.
+    auto run_program = [server](const std::function<int()> &program_main) {
+        return server != nullptr ? run_in_child(program_main) : program_main();
+    };
+    if (backend_opt.value() != "llvm" && backend_opt.value() != "fast") {
+        throw std::runtime_error("Invalid backend " + backend_opt.value());
+    }
+    bool fast_backend = backend_opt.value() == "fast";
+    unsigned codegen_threads = std::stoul(codegen_threads_opt.value());
+    if (codegen_threads == 0) {
+        throw std::runtime_error("Invalid codegen thread count " + codegen_threads_opt.value());
+    }
 
-    PassManager pass_manager;
-    pass_manager.add<TypeChecker>();
-    pass_manager.add<VarChecker>();
-    pass_manager.add<ConcreteImplementer>();
-    pass_manager.add<StackPromoter>();
-    if (dump_ir_opt.present_or_true()) {
-        pass_manager.add<ir::Dumper>();
+    // Without any target options, objects are built for the host CPU model and the JIT detects the host itself.
+    // --march=native selects the host CPU along with its exact features, --march=<cpu> just a CPU, and
+    // --target-cpu/--target-features override or extend that.
+    bool custom_target = march_opt.present() || target_cpu_opt.present() || target_features_opt.present();
+    std::string target_cpu = llvm::sys::getHostCPUName().str();
+    std::string target_features;
+    if (march_opt.value() == "native") {
+        target_features = host_cpu_features();
+    } else if (!march_opt.value().empty()) {
+        target_cpu = march_opt.value();
+    }
+    if (!target_cpu_opt.value().empty()) {
+        target_cpu = target_cpu_opt.value();
+    }
+    if (!target_features_opt.value().empty()) {
+        target_features += (target_features.empty() ? "" : ",") + target_features_opt.value();
+    }
+    if (custom_target) {
+        check_target_cpu(target_cpu);
     }
-    pass_manager.run(*program);
-    abort_if_error();
 
-    llvm::LLVMContext context;
-    auto module = gen_llvm(*program, &context);
-    if (dump_llvm_opt.present_or_true()) {
-        module->print(llvm::errs(), nullptr);
+    // Instrumented programs write their profile when _start exits, which only happens for hosted programs built to an
+    // executable with the LLVM backend.
+    bool profile_generate = profile_generate_opt.present_or_true();
+    if (profile_generate && (run || fast_backend || freestanding.present_or_true())) {
+        throw std::runtime_error("--profile-generate requires build mode with the llvm backend and no --freestanding");
     }
-    if (verify_llvm_opt.present_or_true()) {
-        auto print_newline = [] {
-            llvm::errs() << '\n';
-            return true;
-        };
-        ENSURE(!llvm::verifyModule(*module, &llvm::errs()) || !print_newline());
+    if (profile_generate && !profile_use_opt.value().empty()) {
+        throw std::runtime_error("--profile-generate and --profile-use can't be used together");
+    }
+
+    // Incremental builds emit an object per source file, so every function has to be kept in the object of the file
+    // defining it, even if nothing uses it.
+    bool incremental = !incremental_opt.value().empty();
+    if (incremental && (run || fast_backend || profile_generate || !cache_dir_opt.value().empty() ||
+                        codegen_threads_opt.present())) {
+        throw std::runtime_error("--incremental requires build mode with the llvm backend and can't be used with "
+                                 "--cache-dir, --codegen-threads or --profile-generate");
+    }
+
+    // Remarks are located by line, so line tables are needed for LLVM's remarks.
+    bool remarks_enabled = !remarks_opt.value().empty();
+    bool debug_info = debug_info_opt.present_or_true() || remarks_enabled;
+
+    // `kodoc build-many <files...> -o=<dir>` builds many independent programs, sharing the parsed standard library.
+    if (many) {
+        if (fast_backend || profile_generate || !profile_use_opt.value().empty() || remarks_enabled || incremental ||
+            !cache_dir_opt.value().empty()) {
+            throw std::runtime_error("build-many requires the llvm backend and can't be used with --cache-dir, "
+                                     "--incremental, --profile-generate, --profile-use or --remarks");
+        }
+        std::vector<std::string> input_files{input_file};
+        input_files.insert(input_files.end(), extra_input_files.begin(), extra_input_files.end());
+        LLVMGenOptions llvm_gen_options;
+        llvm_gen_options.debug_info = debug_info;
+        llvm_gen_options.frame_pointers = frame_pointers_opt.present_or_true();
+        if (custom_target) {
+            llvm_gen_options.target_cpu = target_cpu;
+            llvm_gen_options.target_features = target_features;
+        }
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmParser();
+        llvm::InitializeNativeTargetAsmPrinter();
+        ParseCache parse_cache;
+        auto thread_count =
+            codegen_threads_opt.present() ? codegen_threads : std::max(std::thread::hardware_concurrency(), 1U);
+        return build_many(input_files, output_dir_opt.value(), server != nullptr ? server->parse_cache : parse_cache,
+                          freestanding.present_or_true(), llvm_gen_options,
+                          target_machine_creator(target_cpu, target_features), thread_count,
+                          print_stats_opt.present_or_true());
+    }
+
+    auto parse_start = std::chrono::steady_clock::now();
+    Compiler compiler(server != nullptr ? &server->parse_cache : nullptr);
+    compiler.parse(input_file, freestanding.present_or_true(), profile_generate);
+    if (print_stats_opt.present_or_true()) {
+        print_phase_time("frontend: parsing", parse_start);
+    }
+
+    // Everything other than the sources which affects the generated code, for keying cached objects.
+    std::string target_key = llvm::sys::getProcessTriple() + '-' + target_cpu + '-' + target_features;
+    std::string options = mode_string + '-' + backend_opt.value();
+    if (freestanding.present_or_true()) {
+        options += "-freestanding";
+    }
+    if (debug_info) {
+        options += "-g";
+    }
+    if (frame_pointers_opt.present_or_true()) {
+        options += "-frame-pointers";
+    }
+    if (codegen_threads_opt.present()) {
+        options += "-split";
+    }
+    if (profile_generate) {
+        options += "-profile-generate";
+    }
+    if (!profile_use_opt.value().empty()) {
+        std::ifstream profile_stream(profile_use_opt.value(), std::ios::binary);
+        options += "-profile-use-";
+        options.append(std::istreambuf_iterator<char>(profile_stream), {});
+    }
+
+    // Look for an already compiled object before doing any more work. Remarks are only produced by actually compiling
+    // the program, so the cache is bypassed when they are requested.
+    Box<ObjectCache> object_cache;
+    std::unique_ptr<llvm::MemoryBuffer> object;
+    if (!cache_dir_opt.value().empty() && !interpret_program && !remarks_enabled) {
+        object_cache = Box<ObjectCache>::create(cache_dir_opt.value(),
+                                                ObjectCache::compute_key(compiler.sources(), target_key, options));
+        object = object_cache->lookup();
+        if (print_stats_opt.present_or_true()) {
+            fmt::print("cache: {} for {} ({} hits, {} misses)\n", object ? "hit" : "miss",
+                       object_cache->key(), object_cache->hits(), object_cache->misses());
+        }
+    }
+
+    // Declared before the context so that remarks are written after the context has finished with them.
+    Box<RemarkStream> remarks;
+    auto context = std::make_unique<llvm::LLVMContext>();
+    context->setDiscardValueNames(discard_value_names_opt.present_or_true());
+    if (remarks_enabled) {
+        remarks = Box<RemarkStream>::create(context.get(), remarks_opt.value(), remarks_format_opt.value(),
+                                            !profile_use_opt.value().empty());
+    }
+    Box<ir::Program> program;
+    std::unique_ptr<llvm::Module> module;
+    if (!object) {
+        auto ir_gen_start = std::chrono::steady_clock::now();
+        program = compiler.compile(!incremental);
+        if (print_stats_opt.present_or_true()) {
+            print_phase_time("frontend: ir generation", ir_gen_start);
+        }
+        auto passes_start = std::chrono::steady_clock::now();
+        PassManager pass_manager;
+        pass_manager.set_remarks(*remarks);
+        add_common_passes(pass_manager, print_stats_opt.present_or_true());
+        if (!incremental) {
+            pass_manager.add<DeadFunctionEliminator>(print_stats_opt.present_or_true());
+        }
+        if (profile_generate) {
+            pass_manager.add<ProfileInstrumenter>();
+        }
+        if (dump_ir_opt.present_or_true()) {
+            pass_manager.add<ir::Dumper>();
+        }
+        pass_manager.run(*program);
+        abort_if_error();
+        if (print_stats_opt.present_or_true()) {
+            print_phase_time("passes: running passes", passes_start);
+        }
+
+        Box<Profile> profile;
+        if (!profile_use_opt.value().empty()) {
+            profile = Box<Profile>::create(Profile::read(*program, profile_use_opt.value()));
+        }
+        if (*remarks != nullptr) {
+            remarks->flush(*program, *profile);
+        }
+
+        // The interpreter runs the IR directly, skipping LLVM entirely.
+        if (interpret_program) {
+            if (print_stats_opt.present_or_true()) {
+                print_phase_time("interpreter: startup", start_time);
+                std::fflush(stdout);
+            }
+            return run_program([&] {
+                return interpret(*program);
+            });
+        }
+
+        // The fast backend emits an object directly, which is then handled the same as a cached object.
+        if (fast_backend) {
+            auto codegen_start = std::chrono::steady_clock::now();
+            auto buffer = gen_fast_object(*program);
+            if (print_stats_opt.present_or_true()) {
+                print_phase_time("fast backend: codegen", codegen_start);
+            }
+            object = llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(buffer.data(), buffer.size()));
+            if (*object_cache != nullptr) {
+                object_cache->store(*object);
+            }
+        } else {
+            auto lowering_start = std::chrono::steady_clock::now();
+            LLVMGenOptions llvm_gen_options;
+            llvm_gen_options.debug_info = debug_info;
+            llvm_gen_options.profile = *profile;
+            llvm_gen_options.frame_pointers = frame_pointers_opt.present_or_true();
+            if (custom_target) {
+                llvm_gen_options.target_cpu = target_cpu;
+                llvm_gen_options.target_features = target_features;
+            }
+            module = gen_llvm(*program, context.get(), llvm_gen_options);
+            if (print_stats_opt.present_or_true()) {
+                print_phase_time("llvm: lowering", lowering_start);
+            }
+            if (dump_llvm_opt.present_or_true()) {
+                module->print(llvm::errs(), nullptr);
+            }
+            if (verify_llvm_opt.present_or_true()) {
+                auto print_newline = [] {
+                    llvm::errs() << '\n';
+                    return true;
+                };
+                ENSURE(!llvm::verifyModule(*module, &llvm::errs()) || !print_newline());
+            }
+        }
     }
 
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmParser();
     llvm::InitializeNativeTargetAsmPrinter();
     if (run) {
-        auto *function = module->getFunction("main");
-        ENSURE(function != nullptr);
-        llvm::EngineBuilder engine_builder(std::move(module));
-        engine_builder.setEngineKind(llvm::EngineKind::Either);
-        Box<llvm::ExecutionEngine> engine(engine_builder.create());
-        return engine->runFunctionAsMain(function, {}, nullptr);
-    }
-    llvm::TargetOptions options;
-    const auto *target = &*llvm::TargetRegistry::targets().begin();
-    Box<llvm::TargetMachine> machine(target->createTargetMachine(
-        llvm::sys::getDefaultTargetTriple(), llvm::sys::getHostCPUName(), "", options, llvm::Reloc::DynamicNoPIC));
-    std::error_code ec;
-    llvm::raw_fd_ostream output("out.o", ec, llvm::sys::fs::OF_None);
-    llvm::legacy::PassManager pm;
-    machine->addPassesToEmitFile(pm, output, nullptr, llvm::CodeGenFileType::CGFT_ObjectFile);
-    pm.run(*module);
-    output.flush();
+        // Make JIT compiled code visible to perf, either through a perf map or, with line info when built with -g,
+        // through jitdump files.
+        std::vector<llvm::JITEventListener *> listeners;
+        Box<PerfMapListener> perf_map_listener;
+        if (perf_map_opt.present_or_true()) {
+            perf_map_listener = Box<PerfMapListener>::create();
+            listeners.push_back(*perf_map_listener);
+        }
+        if (jitdump_opt.present_or_true()) {
+            auto *perf_listener = llvm::JITEventListener::createPerfJITEventListener();
+            if (perf_listener == nullptr) {
+                print_error_and_abort("jitdump support isn't available in this build of LLVM");
+            }
+            listeners.push_back(perf_listener);
+        }
+        auto machine_builder = llvm::cantFail(llvm::orc::JITTargetMachineBuilder::detectHost());
+        if (custom_target) {
+            machine_builder.setCPU(target_cpu);
+            machine_builder.getFeatures() = llvm::SubtargetFeatures(target_features);
+        }
+        auto jit = create_jit(*object_cache, std::move(machine_builder), listeners);
+        auto &main_dylib = jit->getMainJITDylib();
+        main_dylib.addGenerator(llvm::cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            jit->getDataLayout().getGlobalPrefix())));
+        if (object) {
+            llvm::cantFail(jit->addObjectFile(std::move(object)));
+        } else {
+            ENSURE(module->getFunction("main") != nullptr);
+            module->setDataLayout(jit->getDataLayout());
+            module->setTargetTriple(jit->getTargetTriple().str());
+            llvm::orc::ThreadSafeModule thread_safe_module(std::move(module), std::move(context));
+            if (*object_cache == nullptr) {
+                auto &lazy_jit = static_cast<llvm::orc::LLLazyJIT &>(*jit);
+                llvm::cantFail(lazy_jit.addLazyIRModule(std::move(thread_safe_module)));
+            } else {
+                llvm::cantFail(jit->addIRModule(std::move(thread_safe_module)));
+            }
+        }
+        auto main_symbol = llvm::cantFail(jit->lookup("main"));
+        auto *main_function = llvm::jitTargetAddressToPointer<int (*)()>(main_symbol.getAddress());
+        if (print_stats_opt.present_or_true()) {
+            print_phase_time("jit: startup", start_time);
+            std::fflush(stdout);
+        }
+        return run_program(main_function);
+    }
+
+    std::vector<std::unique_ptr<llvm::MemoryBuffer>> objects;
+    if (object) {
+        objects.push_back(std::move(object));
+    } else {
+        auto codegen_start = std::chrono::steady_clock::now();
+        auto create_machine = target_machine_creator(target_cpu, target_features);
+        if (incremental) {
+            auto options_key = ObjectCache::compute_key({}, target_key, options);
+            std::size_t rebuilt_count = 0;
+            objects = emit_incremental_objects(compiler.files(), *program, *module, incremental_opt.value(),
+                                               options_key, create_machine, rebuilt_count);
+            if (print_stats_opt.present_or_true()) {
+                fmt::print("incremental: rebuilt {} of {} objects\n", rebuilt_count, objects.size());
+            }
+        } else if (codegen_threads_opt.present()) {
+            objects = emit_objects(*module, create_machine, codegen_threads);
+            if (print_stats_opt.present_or_true()) {
+                fmt::print("codegen: emitted {} objects using {} threads\n", objects.size(), codegen_threads);
+            }
+        } else {
+            objects.push_back(emit_object(*module, *create_machine()));
+        }
+        if (print_stats_opt.present_or_true()) {
+            print_phase_time("codegen: emitting objects", codegen_start);
+        }
+        if (*object_cache != nullptr && objects.size() == 1) {
+            object_cache->store(*objects.front());
+        }
+    }
+
+    // Partitioned and incremental builds are written as out.o, out.1.o, out.2.o and so on.
+    remove_stale_objects(objects.size());
+    for (std::size_t i = 0; i < objects.size(); i++) {
+        std::error_code ec;
+        llvm::raw_fd_ostream output(i == 0 ? "out.o" : fmt::format("out.{}.o", i), ec, llvm::sys::fs::OF_None);
+        output << objects[i]->getBuffer();
+    }
+    if (print_stats_opt.present_or_true()) {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        fmt::print("memory: peak rss was {} KiB\n", usage.ru_maxrss);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    return kodoc_main(argc, argv, nullptr);
 }
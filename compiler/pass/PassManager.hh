@@ -12,6 +12,7 @@
 #include <vector>
 
 class PassUsage;
+class RemarkStream;
 
 class PassManager {
     friend PassUsage;
@@ -19,12 +20,14 @@ class PassManager {
 private:
     std::unordered_map<std::type_index, Box<Pass>> m_pass_map;
     std::unordered_map<const void *, std::unordered_map<std::type_index, Box<PassResult>>> m_results;
+    std::unordered_map<Pass *, bool> m_ready_map;
     std::vector<Pass *> m_transforms;
+    RemarkStream *m_remarks{nullptr};
 
     template <typename T, typename... Args>
     Pass *ensure_pass(Args &&... args);
 
-    void run_pass(ir::Program *program, Pass *pass, std::unordered_map<Pass *, bool> &ready_map);
+    void run_pass(ir::Program *program, Pass *pass);
 
 public:
     template <typename T, typename... Args>
@@ -36,7 +39,28 @@ public:
     template <typename T>
     T *get(const void *obj);
 
+    /// @brief Returns the result `T` for `function`, rerunning its analyser if the result has been invalidated.
+    /// @details Allows a transform to recompute an analysis part way through its run. Any results that the analyser
+    /// itself uses must still be valid.
+    template <typename T>
+    T *ensure(ir::Function *function);
+
+    /// @brief Discards the result `T` computed for `obj`.
+    /// @details Should be called by transforms which modify `obj` in a way that makes the result stale. The analyser
+    /// of `T` will be rerun the next time a pass uses `T`.
+    template <typename T>
+    void invalidate(const void *obj);
+
+    /// @brief Discards every result computed for `obj`, which is about to be destroyed.
+    void forget(const void *obj) { m_results.erase(obj); }
+
     void run(ir::Program *program);
+
+    /// @brief Sets where passes emit optimisation remarks.
+    void set_remarks(RemarkStream *remarks) { m_remarks = remarks; }
+
+    /// @return Where passes should emit optimisation remarks, or null if remarks weren't requested.
+    RemarkStream *remarks() const { return m_remarks; }
 };
 
 template <typename T, typename... Args>
@@ -67,3 +91,19 @@ T *PassManager::get(const void *obj) {
     ASSERT_PEDANTIC(dynamic_cast<T *>(ptr) != nullptr);
     return static_cast<T *>(ptr);
 }
+
+template <typename T>
+T *PassManager::ensure(ir::Function *function) {
+    if (!m_results.contains(function) || !m_results.at(function).contains(std::type_index(typeid(T)))) {
+        ensure_pass<typename T::analyser>()->run(function);
+    }
+    return get<T>(function);
+}
+
+template <typename T>
+void PassManager::invalidate(const void *obj) {
+    m_ready_map[ensure_pass<typename T::analyser>()] = false;
+    if (m_results.contains(obj)) {
+        m_results.at(obj).erase(std::type_index(typeid(T)));
+    }
+}
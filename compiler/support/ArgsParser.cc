@@ -13,12 +13,20 @@ void Parser::parse(int argc, char **argv) {
     for (int i = 1; i < argc; i++) {
         std::string arg(argv[i]);
         if (!arg.starts_with('-')) {
+            if (args == m_args.end()) {
+                if (m_rest_args == nullptr) {
+                    throw std::runtime_error("Invalid number of args passed");
+                }
+                m_rest_args->push_back(std::move(arg));
+                continue;
+            }
             // TODO: Merge these.
             **args = std::move(arg);
             args++;
             continue;
         }
-        arg = arg.substr(2);
+        // Single letter options, such as -g, only take one dash.
+        arg = arg.substr(arg.starts_with("--") ? 2 : 1);
         auto it = std::find_if(m_options.begin(), m_options.end(), [&arg](const Option &option) {
             return arg.starts_with(option.name());
         });
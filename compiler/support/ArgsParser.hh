@@ -43,11 +43,15 @@ public:
 
 class Parser {
     std::vector<std::string *> m_args;
+    std::vector<std::string> *m_rest_args{nullptr};
     std::vector<Option> m_options;
 
 public:
     void add_arg(std::string *arg) { m_args.push_back(arg); }
 
+    /// @brief Collects any args passed after those added with `add_arg` into `rest_args`, rather than rejecting them.
+    void add_rest_args(std::vector<std::string> *rest_args) { m_rest_args = rest_args; }
+
     template <typename... Args>
     Option &add_option(Args &&... args) {
         return m_options.emplace_back(std::forward<Args>(args)...);
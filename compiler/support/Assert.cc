@@ -5,5 +5,9 @@
 [[noreturn]] void assertion_failed(const char *file, unsigned int line, const char *expr) {
     print_error("Assertion '{}' failed at {}:{}", expr, file, line);
     print_note("This is a compiler bug!");
+    // A server has to survive to return the diagnostics to its client.
+    if (g_diagnostics != nullptr) {
+        abort_compilation();
+    }
     std::abort();
 }
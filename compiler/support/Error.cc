@@ -1,10 +1,28 @@
 #include <support/Error.hh>
 
+#include <cstdlib>
+
 bool g_error = false;
+std::string *g_diagnostics = nullptr;
+
+void print_diagnostic(const std::string &diagnostic) {
+    if (g_diagnostics != nullptr) {
+        g_diagnostics->append(diagnostic);
+        return;
+    }
+    fmt::print("{}", diagnostic);
+}
+
+void abort_compilation() {
+    if (g_diagnostics != nullptr) {
+        throw CompilationAborted();
+    }
+    std::exit(1);
+}
 
 void abort_if_error() {
     if (g_error) {
         print_note("Aborting due to previous errors");
-        std::exit(1);
+        abort_compilation();
     }
 }
@@ -3,9 +3,21 @@
 #include <fmt/color.h>
 #include <fmt/core.h>
 
+#include <string>
+
 // TODO: Global :(
 extern bool g_error;
 
+// When set, diagnostics are appended to the string instead of being printed, and aborting throws CompilationAborted
+// instead of exiting. Used by `kodoc serve` to return diagnostics to its clients.
+extern std::string *g_diagnostics;
+
+/// @brief Thrown by aborting functions when `g_diagnostics` is set.
+struct CompilationAborted {};
+
+void print_diagnostic(const std::string &diagnostic);
+[[noreturn]] void abort_compilation();
+
 template <typename T>
 concept HasLine = requires(const T *t) {
     static_cast<int>(t->line());
@@ -16,7 +28,7 @@ void print_error(const FmtStr &fmt, const Args &... args) {
     g_error = true;
     auto formatted = fmt::format(fmt, args...);
     auto error = fmt::format(fmt::fg(fmt::color::orange_red), "error:");
-    fmt::print("{} {}\n", error, formatted);
+    print_diagnostic(fmt::format("{} {}\n", error, formatted));
 }
 
 template <typename T, typename FmtStr, typename... Args>
@@ -35,14 +47,14 @@ template <typename FmtStr, typename... Args>
 void print_note(const FmtStr &fmt, const Args &... args) {
     auto formatted = fmt::format(fmt, args...);
     auto note = fmt::format(fmt::fg(fmt::color::slate_blue), " note:");
-    fmt::print("{} {}\n", note, formatted);
+    print_diagnostic(fmt::format("{} {}\n", note, formatted));
 }
 
 template <typename FmtStr, typename... Args>
 [[noreturn]] void print_error_and_abort(const FmtStr &fmt, const Args &... args) {
     print_error(fmt, args...);
     print_note("Aborting due to previous error");
-    std::exit(1);
+    abort_compilation();
 }
 
 void abort_if_error();
@@ -57,6 +57,7 @@ public:
     template <typename U, typename... Args>
     U *emplace(iterator it, Args &&... args) requires std::derived_from<U, T>;
     void insert(iterator it, T *elem);
+    void splice(iterator it, List &other);
     iterator erase(iterator it);
 
     T *operator[](std::size_t n);
@@ -115,6 +116,25 @@ void List<T>::insert(iterator it, T *elem) {
     prev->set_next(elem);
 }
 
+// clang-format off
+template <typename T> requires std::derived_from<T, ListNode>
+void List<T>::splice(iterator it, List &other) {
+    // clang-format on
+    if (other.empty()) {
+        return;
+    }
+    auto *first = *other.begin();
+    auto *last = other.m_end->prev();
+    other.m_end->set_prev(*other.m_end);
+    other.m_end->set_next(*other.m_end);
+
+    auto *prev = it->prev();
+    first->set_prev(prev);
+    last->set_next(*it);
+    prev->set_next(first);
+    it->set_prev(last);
+}
+
 // clang-format off
 template <typename T> requires std::derived_from<T, ListNode>
 typename List<T>::iterator List<T>::erase(iterator it) {
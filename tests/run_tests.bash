@@ -2,22 +2,36 @@
 
 COMPILER=$1
 run_test() {
-    printf "Running test '%s' " $1
-    OUTPUT=$($COMPILER run $(dirname $0)/$1)
-    RET=$?
-    OUTPUT_STRIPPED=$(echo "$OUTPUT" | sed 's/\x1b\[[0-9;]*m//g')
-    if [ $2 -ne $RET ] || [ "$3" != "$OUTPUT_STRIPPED" ]
+    # Successful programs have to behave the same on every backend and in the interpreter.
+    MODES=("")
+    if [[ $1 == success/* ]]
     then
-        printf "\u001b[31mFAILED\u001b[0m\n"
-        printf "%s" "$(echo "$OUTPUT" | sed 's/^//g')"
-        printf "\u001b[0m"
-        if not [ -z "$OUTPUT" ]
+        MODES+=("--backend=fast" "--interpret")
+    fi
+    for MODE in "${MODES[@]}"
+    do
+        if [ -z "$MODE" ]
         then
-            printf "\n"
+            printf "Running test '%s' " $1
+        else
+            printf "Running test '%s' (%s) " $1 $MODE
         fi
-    else
-        printf "\u001b[32mOK\u001b[0m\n"
-    fi
+        OUTPUT=$($COMPILER run $(dirname $0)/$1 $MODE)
+        RET=$?
+        OUTPUT_STRIPPED=$(echo "$OUTPUT" | sed 's/\x1b\[[0-9;]*m//g')
+        if [ $2 -ne $RET ] || [ "$3" != "$OUTPUT_STRIPPED" ]
+        then
+            printf "\u001b[31mFAILED\u001b[0m\n"
+            printf "%s" "$(echo "$OUTPUT" | sed 's/^//g')"
+            printf "\u001b[0m"
+            if not [ -z "$OUTPUT" ]
+            then
+                printf "\n"
+            fi
+        else
+            printf "\u001b[32mOK\u001b[0m\n"
+        fi
+    done
 }
 
 # Expecting compile error.
@@ -49,14 +63,20 @@ run_test "success/comparison.kd" 1 ""
 run_test "success/complex_expression.kd" 55 ""
 run_test "success/complex_struct.kd" 24 ""
 run_test "success/const_decl.kd" 20 ""
+run_test "success/constant_branches.kd" 7 "AC"
+run_test "success/dead_store_branch.kd" 22 ""
 run_test "success/hello_world.kd" 0 "Hello, world!"
 run_test "success/implicit_extension.kd" 10 ""
 run_test "success/inline_asm.kd" 0 "Hello, world!"
 run_test "success/instance_member_function.kd" 20 ""
 run_test "success/libc_hi.kd" 0 "Hi"
 run_test "success/malloc.kd" 0 "A"
+run_test "success/many_args.kd" 36 ""
 run_test "success/mutability.kd" 20 ""
 run_test "success/pointer_mutability.kd" 70 ""
+run_test "success/pointer_writes.kd" 16 ""
+run_test "success/returned_pointer.kd" 5 ""
 run_test "success/simple_if.kd" 0 "AAA"
 run_test "success/static_member_function.kd" 5 ""
+run_test "success/struct_copy.kd" 63 ""
 run_test "success/type_alias.kd" 5 ""